@@ -5,7 +5,10 @@ enum Mode
 {
     TEST = 0,
     TRACK_RUN = 1,
-    DRY_RUN = 2
+    DRY_RUN = 2,
+    UPLOADED = 3 // the sequence sent over Serial
 };
 
+#define MODE_COUNT 4
+
 #endif
\ No newline at end of file
@@ -23,7 +23,8 @@ extern const double TURN_PID_KP;
 extern const double TURN_PID_KI;
 extern const double TURN_PID_KD;
 
-extern CommandSequence runSequence;
-extern CommandSequence testSequence;
+// Defined constexpr, built at compile time and kept in flash
+extern const CommandSequence runSequence;
+extern const CommandSequence testSequence;
 
 #endif
@@ -0,0 +1,106 @@
+#ifndef CONTROL_LOOP_H
+#define CONTROL_LOOP_H
+
+#include <stdint.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <chrono>
+#include <thread>
+#endif
+
+// Paces a control loop at a fixed period on absolute wake times, so the rate does not
+// drift with the time the loop body takes, and records how long each cycle really took.
+// On the ESP32 the period is rounded to whole FreeRTOS ticks (1 ms).
+class ControlLoop
+{
+private:
+    uint32_t _periodUs;
+    uint32_t _lastCycle = 0;
+    uint32_t _cycles = 0;
+    uint32_t _minUs = 0;
+    uint32_t _maxUs = 0;
+    uint32_t _overruns = 0;
+    uint64_t _totalUs = 0;
+#ifdef ARDUINO
+    TickType_t _lastWake = 0;
+    TickType_t _periodTicks;
+#else
+    std::chrono::steady_clock::time_point _nextWake;
+#endif
+
+    static uint32_t nowUs()
+    {
+#ifdef ARDUINO
+        return micros();
+#else
+        return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+#endif
+    }
+
+public:
+    ControlLoop(uint32_t periodUs) : _periodUs(periodUs)
+    {
+#ifdef ARDUINO
+        _periodTicks = pdMS_TO_TICKS(periodUs / 1000);
+        if (_periodTicks == 0)
+            _periodTicks = 1;
+        _periodUs = _periodTicks * portTICK_PERIOD_MS * 1000;
+#endif
+    }
+
+    // Start timing from now
+    void start()
+    {
+        _cycles = 0;
+        _minUs = 0xFFFFFFFF;
+        _maxUs = 0;
+        _overruns = 0;
+        _totalUs = 0;
+        _lastCycle = nowUs();
+#ifdef ARDUINO
+        _lastWake = xTaskGetTickCount();
+#else
+        _nextWake = std::chrono::steady_clock::now();
+#endif
+    }
+
+    // Sleep until the next period starts
+    void wait()
+    {
+#ifdef ARDUINO
+        vTaskDelayUntil(&_lastWake, _periodTicks);
+#else
+        _nextWake += std::chrono::microseconds(_periodUs);
+        std::this_thread::sleep_until(_nextWake);
+#endif
+        uint32_t now = nowUs();
+        uint32_t interval = now - _lastCycle;
+        _lastCycle = now;
+        _cycles++;
+        _totalUs += interval;
+        if (interval < _minUs)
+            _minUs = interval;
+        if (interval > _maxUs)
+            _maxUs = interval;
+        if (interval > _periodUs + _periodUs / 2)
+            _overruns++;
+    }
+
+    // Nominal period, s, the dt of a fixed-rate controller
+    float period() const { return _periodUs / 1000000.0f; }
+    uint32_t periodUs() const { return _periodUs; }
+
+    // Timing of the cycles since start(), us
+    uint32_t cycles() const { return _cycles; }
+    uint32_t minInterval() const { return _cycles ? _minUs : 0; }
+    uint32_t maxInterval() const { return _maxUs; }
+    uint32_t meanInterval() const { return _cycles ? (uint32_t)(_totalUs / _cycles) : 0; }
+    // Cycles that took more than 1.5 periods
+    uint32_t overruns() const { return _overruns; }
+};
+
+#endif
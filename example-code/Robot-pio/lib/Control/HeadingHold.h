@@ -0,0 +1,54 @@
+#ifndef HEADING_HOLD_H
+#define HEADING_HOLD_H
+
+#include <math.h>
+#include "Pid.h"
+
+// Holds the heading of a move by slowing one wheel in proportion to the heading error.
+// The wheel to slow swaps when moving backward. The step scheduler lengthens the move
+// by half the skipped steps, so the move still covers its distance.
+class HeadingHold
+{
+private:
+    Pid _pid;
+    float _maxError = 0;
+
+public:
+    // kp: trim per degree, ki: trim per degree second, maxTrim: largest fraction a wheel
+    // is slowed down, dt: update period, s
+    HeadingHold(float kp, float ki, float maxTrim, float dt)
+        : _pid(kp, ki, 0, -maxTrim, maxTrim, dt) {}
+
+    void reset()
+    {
+        _pid.reset();
+        _maxError = 0;
+    }
+
+    // Call once per period with the measured yaw and the heading to hold, degrees,
+    // a positive yaw to the left. leftTrim and rightTrim receive the wheel speed
+    // scales, 1 for full speed.
+    void update(float yaw, float heading, bool backward, float *leftTrim, float *rightTrim)
+    {
+        float error = yaw - heading;
+        // The yaw wraps at +-180 degrees
+        if (error > 180)
+            error -= 360;
+        else if (error < -180)
+            error += 360;
+        if (fabsf(error) > _maxError)
+            _maxError = fabsf(error);
+
+        // Hold the heading at 0, a positive error gives a positive trim
+        float trim = -_pid.update(0, error);
+        if (backward)
+            trim = -trim;
+        *leftTrim = trim < 0 ? 1 + trim : 1;
+        *rightTrim = trim > 0 ? 1 - trim : 1;
+    }
+
+    // Largest heading error seen since the start, degrees
+    float maxError() const { return _maxError; }
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef PID_H
+#define PID_H
+
+// PID controller for a loop that runs at a fixed period, in single precision.
+// The derivative is taken on the measurement, so setpoint changes do not kick the output,
+// and the integrator is clamped to the output range and stops integrating while the
+// output is saturated in the direction of the error, so it cannot wind up.
+class Pid
+{
+private:
+    float _kp;
+    float _ki; // per second
+    float _kd; // seconds
+    float _outMin;
+    float _outMax;
+    float _dt; // loop period, s
+    float _integral = 0;
+    float _lastMeasurement = 0;
+    bool _started = false;
+
+    float clamp(float value) const
+    {
+        if (value > _outMax)
+            return _outMax;
+        if (value < _outMin)
+            return _outMin;
+        return value;
+    }
+
+public:
+    Pid(float kp, float ki, float kd, float outMin, float outMax, float dt)
+        : _kp(kp), _ki(ki), _kd(kd), _outMin(outMin), _outMax(outMax), _dt(dt) {}
+
+    void reset()
+    {
+        _integral = 0;
+        _started = false;
+    }
+
+    // Call once per period
+    float update(float setpoint, float measurement)
+    {
+        float error = setpoint - measurement;
+        float derivative = _started ? (measurement - _lastMeasurement) / _dt : 0;
+        _lastMeasurement = measurement;
+        _started = true;
+
+        float unclamped = _kp * error + _integral - _kd * derivative;
+        bool saturatedHigh = unclamped >= _outMax && error > 0;
+        bool saturatedLow = unclamped <= _outMin && error < 0;
+        if (!saturatedHigh && !saturatedLow)
+            _integral = clamp(_integral + _ki * error * _dt);
+
+        return clamp(_kp * error + _integral - _kd * derivative);
+    }
+
+    float integral() const { return _integral; }
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef TURN_CONTROLLER_H
+#define TURN_CONTROLLER_H
+
+#include <math.h>
+
+// Turn rate command that brakes along a constant deceleration profile onto the target.
+// The measured angle is projected forward over the IMU latency, so braking starts on
+// where the robot is now rather than where the sensor last saw it, and the turn ends
+// without a slow final crawl. The wheels follow the commanded rate, so the rate over
+// the latency runs from the gyro rate to the last command: the projection uses their mean.
+class TurnController
+{
+private:
+    float _maxRate;   // deg/s
+    float _accel;     // deg/s^2, used for both speeding up and braking
+    float _minRate;   // deg/s, floor so the last fraction of a degree still closes
+    float _latency;   // s, age of the IMU angle when it is read
+    float _threshold; // deg, done when the predicted remaining angle is within this
+    float _command = 0;
+    float _predicted = 0;
+
+public:
+    TurnController(float maxRate, float accel, float minRate, float latency, float threshold)
+        : _maxRate(maxRate), _accel(accel), _minRate(minRate), _latency(latency), _threshold(threshold) {}
+
+    void reset()
+    {
+        _command = 0;
+        _predicted = 0;
+    }
+
+    // target: turn size, angle: measured progress, rate: gyro rate along the turn, all positive
+    // in the turn direction. dt: time since the last update, s.
+    // Returns the commanded turn rate in deg/s, 0 once the target is reached.
+    float update(float target, float angle, float rate, float dt)
+    {
+        _predicted = angle + (rate + _command) / 2 * _latency;
+        float remaining = target - _predicted;
+        if (remaining <= _threshold)
+        {
+            _command = 0;
+            return 0;
+        }
+
+        // Fastest rate that can still stop in the remaining angle
+        float braking = sqrtf(2 * _accel * remaining);
+        float command = _command + _accel * dt;
+        if (command > braking)
+            command = braking;
+        if (command > _maxRate)
+            command = _maxRate;
+        if (command < _minRate)
+            command = _minRate;
+        _command = command;
+        return command;
+    }
+
+    // Angle the robot is estimated to be at, from the last update
+    float predictedAngle() const { return _predicted; }
+};
+
+#endif
@@ -2,109 +2,114 @@
 #define IMU_H
 
 #include "JY901.h"
+#include "YawFilter.h"
+#include "YawFusion.h"
+
+// One IMU reading as published to the control loops
+struct ImuSample
+{
+    double angle;      // turn angle since the last reset, degrees
+    double yaw;        // signed yaw since the last reset, degrees
+    double rate;       // Z rate, degrees/s
+    uint32_t micros;   // time of the read
+    uint32_t sequence; // counts the readings, a new value means a new reading
+};
 
 class IMU
 {
 private:
-    // Constants for filtering and conversion
-    static constexpr double ANGLE_THRESHOLD = 40.0;
-    static constexpr double JUMP_THRESHOLD = 1.5;
-    static constexpr int MAX_FILTER_ATTEMPTS = 6;
+    // Gyro fusion: time constant the angle register corrects the integrated rate with,
+    // and how far the angle register lags the gyro register, s
+    static constexpr double FUSION_TIME_CONSTANT = 0.05;
+    static constexpr double FUSION_ANGLE_LAG = 0.015;
+    // The sensor returns the yaw of before a reset until its next update
+    static constexpr double RESET_TOLERANCE = 1.0;    // degrees, a yaw this close to 0 is after the reset
+    static constexpr unsigned long RESET_SETTLE_MS = 20;
+
+    YawFilter filter;
+    YawFusion fusion{FUSION_TIME_CONSTANT, FUSION_ANGLE_LAG};
+    bool fused = false;
 
-    double prev_z_angle = 0;
     double z_angle = 0;
-    double curr_z_angle = 0;
+    double z_rate = 0; // degrees/s, from the same read as the angle
+    uint32_t sample_micros = 0; // time of the last read
 
     // Add error state
     bool imu_error = false;
 
-    // Add timeout handling
-    unsigned long last_update = 0;
-    static constexpr unsigned long TIMEOUT_MS = 10;
-
     unsigned long count = 0;
 
+    // Wait for a read still on the bus, its angle is from before the reset
+    void dropPendingSample()
+    {
+        if (JY901.ReadState() != JY901_IDLE)
+            JY901.FinishSample();
+    }
+
 public:
     void Start()
     {
         JY901.StartIIC();
-        // Add initialization check
-        JY901.GetAngle();
+        if (!JY901.GetAngle())
+        {
+            imu_error = true;
+            logger.error("IMU not responding");
+        }
     }
 
-    void ResetAngle()
+    // Integrate the gyro rate between angle reads instead of waiting for the angle register
+    void SetFusion(bool useFusion)
     {
-        JY901.WriteWord(0x76, 0x00);
-        prev_z_angle = 0;
-        z_angle = 0;
-        curr_z_angle = 0;
-        count = 0;
+        fused = useFusion;
     }
 
-    void UpdateAngle()
+    // Returns false when the yaw did not read near 0 within RESET_SETTLE_MS, the filters would
+    // then take the old yaw as the first angle of the turn
+    bool ResetAngle()
     {
-        int cnt = 0;
-        double tmp_min = 99999;
-        double tmp_max = 0;
-
-        JY901.GetAngle();
-        curr_z_angle = abs((double)JY901.stcAngle.Angle[2] / 32768.0 * 180);
-
-        tmp_min = _min(curr_z_angle, tmp_min);
-        tmp_max = _max(curr_z_angle, tmp_max);
-        // Filter out sudden large jumps in angle readings
-        unsigned long start_time = millis();
-
-        while (prev_z_angle > ANGLE_THRESHOLD &&
-               curr_z_angle - prev_z_angle > JUMP_THRESHOLD &&
-               cnt < MAX_FILTER_ATTEMPTS &&
-               (millis() - start_time) < TIMEOUT_MS)
-        {
-            JY901.GetAngle();
-            curr_z_angle = abs((double)JY901.stcAngle.Angle[2] / 32768.0 * 180);
-            tmp_min = _min(curr_z_angle, tmp_min);
-            tmp_max = _max(curr_z_angle, tmp_max);
-            cnt++;
-        }
-        // Check for timeout condition
-        if ((millis() - start_time) >= TIMEOUT_MS)
-        {
-            imu_error = true;
-            logger.error("IMU filter timeout for first filter");
-        }
-
-        if (cnt > 0)
-        {
-            Serial.println("Fix " + String(prev_z_angle, 3) + " " +
-                           String(curr_z_angle, 3) + " " + String(tmp_min, 3) + " " +
-                           String(tmp_max, 3) + " " + String(cnt));
-            curr_z_angle = tmp_min;
-        }
-
-        // Reset start time for second filter
-        start_time = millis();
+        dropPendingSample();
+        JY901.WriteWord(0x76, 0x00);
+        filter.reset();
+        fusion.reset();
+        z_angle = 0;
+        z_rate = 0;
+        count = 0;
 
-        while (curr_z_angle > 0 &&
-               prev_z_angle > 0 &&
-               curr_z_angle < prev_z_angle &&
-               (millis() - start_time) < TIMEOUT_MS)
+        unsigned long start = millis();
+        while (millis() - start < RESET_SETTLE_MS)
         {
-            JY901.GetAngle();
-            curr_z_angle = abs((double)JY901.stcAngle.Angle[2] / 32768.0 * 180);
+            if (JY901.GetSample() && abs(JY901.stcSample.Angle[2] * JY901_ANGLE_SCALE) < RESET_TOLERANCE)
+                return true;
         }
+        return false;
+    }
 
-        // Check for timeout condition
-        if ((millis() - start_time) >= TIMEOUT_MS)
+    // Reads are pipelined: the sample read last time is collected and the next one is
+    // started before filtering, so the bus works while this task does. Glitches are
+    // filtered on the sample, never by reading again.
+    void UpdateAngle()
+    {
+        if (JY901.ReadState() == JY901_IDLE)
+            JY901.StartSample();
+        bool ok = JY901.FinishSample();
+        JY901.StartSample();
+        if (!ok)
         {
-            logger.error("IMU filter timeout for second filter, prev_z_angle: %D, curr_z_angle: %D", prev_z_angle, curr_z_angle);
-            curr_z_angle = _max(curr_z_angle, prev_z_angle);
+            // The last angle is kept
             imu_error = true;
+            return;
         }
 
+        double yaw = JY901.stcSample.Angle[2] * JY901_ANGLE_SCALE;
+        z_rate = JY901.stcSample.w[2] * JY901_RATE_SCALE;
+        sample_micros = JY901.stcSample.ulMicros;
+        yaw = filter.update(yaw, z_rate, sample_micros);
+        if (fused)
+            yaw = fusion.update(yaw, z_rate, sample_micros);
+        double angle = abs(yaw);
+        // The turn angle only grows, a smaller reading is noise around a stop
+        z_angle = _max(angle, z_angle);
         count++;
-
-        prev_z_angle = z_angle;
-        z_angle = curr_z_angle;
     }
 
     double GetAngle(bool updateAngle = true)
@@ -114,9 +119,63 @@ public:
         return z_angle;
     }
 
+    // Signed yaw in degrees, read straight from the sensor without the turn filters
+    double GetYaw()
+    {
+        if (!JY901.GetAngle())
+            imu_error = true;
+        else
+            sample_micros = micros();
+        count++;
+        return JY901.stcAngle.Angle[2] * JY901_ANGLE_SCALE;
+    }
+
+    // Z angular rate in degrees/s (2000 degrees/s full scale), without an update the rate
+    // read along with the last angle
+    double GetRate(bool updateRate = true)
+    {
+        if (!updateRate)
+            return z_rate;
+        if (!JY901.GetGyro())
+            imu_error = true;
+        z_rate = JY901.stcGyro.w[2] * JY901_RATE_SCALE;
+        return z_rate;
+    }
+
+    // Log the samples per second of separate angle, gyro and acceleration reads against
+    // one burst read of all three
+    void MeasureSampleRate(unsigned long durationMs = 1000)
+    {
+        unsigned long separate = 0;
+        unsigned long start = millis();
+        while (millis() - start < durationMs)
+        {
+            if (JY901.GetAngle() && JY901.GetGyro() && JY901.GetAcc())
+                separate++;
+        }
+
+        unsigned long burst = 0;
+        start = millis();
+        while (millis() - start < durationMs)
+        {
+            if (JY901.GetSample())
+                burst++;
+        }
+        logger.info("IMU samples per second: %u with separate reads, %u with burst reads",
+                    separate * 1000 / durationMs, burst * 1000 / durationMs);
+    }
+
     bool HasError() const { return imu_error; }
 
     unsigned long GetCount() const { return count; }
+
+    // Time of the last good read, us
+    uint32_t GetSampleTime() const { return sample_micros; }
+
+    // Samples the yaw filter replaced by its prediction
+    unsigned long GetOutlierCount() const { return filter.outliers(); }
+
+    unsigned long GetErrorCount() const { return JY901.GetErrorCount(); }
 };
 
 #endif
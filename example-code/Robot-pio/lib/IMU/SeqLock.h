@@ -0,0 +1,70 @@
+#ifndef SEQ_LOCK_H
+#define SEQ_LOCK_H
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+// Publishes a value from one writer task to any number of readers without a lock.
+// The writer never waits. A reader copies the value and checks that the sequence did not
+// change meanwhile, otherwise it copies again, so it never sees half of one write and half
+// of another. The value is kept as atomic words, so the copies are not data races either.
+template <typename T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable type");
+
+private:
+    static const size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    std::atomic<uint32_t> _sequence{0}; // odd while a write is in progress
+    std::atomic<uint32_t> _words[WORDS];
+
+public:
+    SeqLock()
+    {
+        for (size_t i = 0; i < WORDS; i++)
+            _words[i].store(0, std::memory_order_relaxed);
+    }
+
+    // Only one task may write
+    void write(const T &value)
+    {
+        uint32_t words[WORDS] = {};
+        memcpy(words, &value, sizeof(T));
+
+        uint32_t sequence = _sequence.load(std::memory_order_relaxed);
+        _sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; i++)
+            _words[i].store(words[i], std::memory_order_relaxed);
+        _sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    T read() const
+    {
+        uint32_t words[WORDS];
+        uint32_t before, after;
+        do
+        {
+            before = _sequence.load(std::memory_order_acquire);
+            for (size_t i = 0; i < WORDS; i++)
+                words[i] = _words[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = _sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) != 0 || before != after);
+
+        T value;
+        memcpy(&value, words, sizeof(T));
+        return value;
+    }
+
+    // Writes so far
+    uint32_t writes() const
+    {
+        return _sequence.load(std::memory_order_acquire) / 2;
+    }
+};
+
+#endif
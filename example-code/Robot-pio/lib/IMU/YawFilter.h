@@ -0,0 +1,86 @@
+#ifndef YAW_FILTER_H
+#define YAW_FILTER_H
+
+#include <math.h>
+#include <stdint.h>
+
+// Streaming glitch filter for the yaw read from the IMU, constant work per sample.
+// Each angle is checked against the angle predicted from the last good one and the
+// gyro rate read with it. A sample further off than the gate is an outlier: it is
+// counted and the prediction is used instead. The sensor holds a value until its next
+// update, so a glitch repeats for a few reads; an angle still off after MAX_OUTLIER_TIME
+// is taken as it is, the robot really is there.
+class YawFilter
+{
+public:
+    static constexpr double GATE = 1.5; // degrees off the prediction
+    static constexpr uint32_t MAX_OUTLIER_TIME = 15000; // us, three sensor updates at 200 Hz
+
+private:
+    double _angle = 0; // degrees
+    uint32_t _time = 0; // us
+    bool _started = false;
+    bool _outlier = false;
+    uint32_t _firstOutlier = 0; // us, start of the current run of outliers
+    bool _inRun = false;
+    unsigned long _outliers = 0;
+
+    // The same angle in (-180, 180]
+    static double wrap(double degrees)
+    {
+        while (degrees > 180)
+            degrees -= 360;
+        while (degrees <= -180)
+            degrees += 360;
+        return degrees;
+    }
+
+public:
+    void reset()
+    {
+        _started = false;
+        _outlier = false;
+        _inRun = false;
+    }
+
+    // angle in degrees, rate in degrees/s, time of the read in us, returns the filtered angle
+    double update(double angle, double rate, uint32_t micros)
+    {
+        if (!_started)
+        {
+            _angle = angle;
+            _time = micros;
+            _started = true;
+            return _angle;
+        }
+
+        double dt = (uint32_t)(micros - _time) / 1e6;
+        double predicted = wrap(_angle + rate * dt);
+        _time = micros;
+        _outlier = fabs(wrap(angle - predicted)) > GATE;
+        if (_outlier && !_inRun)
+        {
+            _inRun = true;
+            _firstOutlier = micros;
+        }
+        if (_outlier && (uint32_t)(micros - _firstOutlier) <= MAX_OUTLIER_TIME)
+        {
+            _outliers++;
+            _angle = predicted;
+        }
+        else
+        {
+            _outlier = false;
+            _inRun = false;
+            _angle = angle;
+        }
+        return _angle;
+    }
+
+    double angle() const { return _angle; }
+    // True when the last sample was replaced by the prediction
+    bool outlier() const { return _outlier; }
+    unsigned long outliers() const { return _outliers; }
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef YAW_FUSION_H
+#define YAW_FUSION_H
+
+#include <math.h>
+#include <stdint.h>
+
+// Complementary filter on yaw: the gyro rate is integrated at every read, the angle
+// register pulls the result back with the time constant so gyro drift does not build up.
+// The angle register lags the gyro register by the sensor's own filter, it is moved forward
+// by rate * lag before it is compared, otherwise the estimate would settle on the late angle.
+// The estimate is then as old as the gyro register, a few ms.
+class YawFusion
+{
+private:
+    double _timeConstant; // s
+    double _lag;          // s
+    double _yaw = 0;      // degrees
+    double _rate = 0;     // degrees/s, of the last read
+    uint32_t _time = 0;   // us
+    bool _started = false;
+
+    static double wrap(double degrees)
+    {
+        while (degrees > 180)
+            degrees -= 360;
+        while (degrees <= -180)
+            degrees += 360;
+        return degrees;
+    }
+
+public:
+    YawFusion(double timeConstant, double lag) : _timeConstant(timeConstant), _lag(lag) {}
+
+    void reset()
+    {
+        _started = false;
+    }
+
+    // angle and rate of one read, in degrees and degrees/s, time of the read in us
+    double update(double angle, double rate, uint32_t micros)
+    {
+        double measured = wrap(angle + rate * _lag);
+        if (!_started)
+        {
+            _yaw = measured;
+            _rate = rate;
+            _time = micros;
+            _started = true;
+            return _yaw;
+        }
+
+        double dt = (uint32_t)(micros - _time) / 1e6;
+        double integrated = _yaw + (_rate + rate) / 2 * dt;
+        double gain = dt / (_timeConstant + dt);
+        _yaw = wrap(integrated + gain * wrap(measured - integrated));
+        _rate = rate;
+        _time = micros;
+        return _yaw;
+    }
+
+    double yaw() const { return _yaw; }
+};
+
+#endif
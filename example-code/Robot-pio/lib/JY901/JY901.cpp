@@ -1,19 +1,177 @@
 #include "JY901.h"
 #include "string.h"
 
+#ifdef ARDUINO
+static JY901WireBus wireBus;
+#endif
+
 CJY901 ::CJY901()
 {
 	ucDevAddr = 0x50;
+#ifdef ARDUINO
+	pBus = &wireBus;
+#else
+	pBus = NULL;
+#endif
+	ucReadAddr = 0;
+	ucReadLength = 0;
+	eReadState = JY901_IDLE;
+	ulReadRequest = 0;
+	ulReadDone = 0;
+	ulReadMicros = 0;
+	ulErrors = 0;
+#ifdef ARDUINO
+	xBusTask = NULL;
+	xReadDone = NULL;
+	xBus = NULL;
+#else
+	bQuit = false;
+#endif
 }
+#ifndef ARDUINO
+CJY901::~CJY901()
+{
+	if (xBusThread.joinable())
+	{
+		bQuit = true;
+		xBusThread.join();
+	}
+}
+#endif
 void CJY901::StartIIC()
 {
-	ucDevAddr = 0x50;
-	Wire.begin();
+	StartIIC(0x50);
 }
 void CJY901::StartIIC(unsigned char ucAddr)
 {
 	ucDevAddr = ucAddr;
-	Wire.begin();
+	if (pBus != NULL)
+		pBus->begin();
+	startBusTask();
+}
+void CJY901::startBusTask()
+{
+	if (hasBusTask())
+		return;
+#ifdef ARDUINO
+	xReadDone = xSemaphoreCreateBinary();
+	xBus = xSemaphoreCreateMutex();
+	xTaskCreatePinnedToCore(busTask, "JY901_Bus", JY901_BUS_TASK_STACK_SIZE, this,
+							JY901_BUS_TASK_PRIORITY, &xBusTask, JY901_BUS_TASK_CORE);
+#else
+	xBusThread = std::thread(busTask, this);
+#endif
+}
+bool CJY901::hasBusTask() const
+{
+#ifdef ARDUINO
+	return xBusTask != NULL;
+#else
+	return xBusThread.joinable();
+#endif
+}
+void CJY901::lockBus()
+{
+#ifdef ARDUINO
+	if (xBus != NULL)
+		xSemaphoreTake(xBus, portMAX_DELAY);
+#else
+	xBus.lock();
+#endif
+}
+void CJY901::unlockBus()
+{
+#ifdef ARDUINO
+	if (xBus != NULL)
+		xSemaphoreGive(xBus);
+#else
+	xBus.unlock();
+#endif
+}
+unsigned long CJY901::nowMicros()
+{
+#ifdef ARDUINO
+	return micros();
+#else
+	return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+			   std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+#endif
+}
+// Runs the reads handed over by StartRead, the I2C driver sleeps on its interrupt meanwhile
+void CJY901::busTask(void *pvParameter)
+{
+	CJY901 *jy = (CJY901 *)pvParameter;
+	while (true)
+	{
+#ifdef ARDUINO
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+#else
+		while (!jy->xRequest.take(10))
+		{
+			if (jy->bQuit)
+				return;
+		}
+#endif
+		unsigned long ulRequest = jy->ulReadRequest;
+		jy->lockBus();
+		bool ok = jy->readRegisters(jy->ucDevAddr, jy->ucReadAddr, jy->ucReadLength, jy->chrReadBuffer);
+		jy->ulReadMicros = nowMicros();
+		jy->unlockBus();
+		jy->eReadState = ok ? JY901_DONE : JY901_FAILED;
+		// Last, FinishRead takes the read as done once it sees its number here
+		jy->ulReadDone = ulRequest;
+#ifdef ARDUINO
+		xSemaphoreGive(jy->xReadDone);
+#else
+		jy->xReadDone.give();
+#endif
+	}
+}
+bool CJY901::StartRead(unsigned char ucAddr, unsigned char ucLength)
+{
+	if (!hasBusTask() || eReadState == JY901_BUSY || ucLength > JY901_MAX_READ)
+		return false;
+	ucReadAddr = ucAddr;
+	ucReadLength = ucLength;
+	eReadState = JY901_BUSY;
+	ulReadRequest++;
+#ifdef ARDUINO
+	xTaskNotifyGive(xBusTask);
+#else
+	xRequest.give();
+#endif
+	return true;
+}
+bool CJY901::waitReadDone(unsigned long ulTimeoutMs)
+{
+#ifdef ARDUINO
+	return xSemaphoreTake(xReadDone, pdMS_TO_TICKS(ulTimeoutMs)) == pdTRUE;
+#else
+	return xReadDone.take(ulTimeoutMs);
+#endif
+}
+bool CJY901::FinishRead(char chrData[], unsigned long ulTimeoutMs)
+{
+	if (eReadState == JY901_IDLE)
+		return false;
+	// The signal of an earlier read can arrive late, only the number of this read ends the wait
+	unsigned long ulStart = nowMicros();
+	while (ulReadDone != ulReadRequest)
+	{
+		unsigned long ulWaitedMs = (nowMicros() - ulStart) / 1000;
+		if (ulWaitedMs >= ulTimeoutMs || !waitReadDone(ulTimeoutMs - ulWaitedMs))
+		{
+			// Left busy, the bus task finishes it within the Wire timeout and the next read can start
+			ulErrors++;
+			return false;
+		}
+	}
+	bool ok = eReadState == JY901_DONE;
+	if (ok)
+		memcpy(chrData, chrReadBuffer, ucReadLength);
+	eReadState = JY901_IDLE;
+	return ok;
 }
 void CJY901 ::CopeSerialData(unsigned char ucData)
 {
@@ -65,79 +223,109 @@ void CJY901 ::CopeSerialData(unsigned char ucData)
 		ucRxCnt = 0;
 	}
 }
-void CJY901::readRegisters(unsigned char deviceAddr, unsigned char addressToRead, unsigned char bytesToRead, char *dest)
+bool CJY901::readRegisters(unsigned char deviceAddr, unsigned char addressToRead, unsigned char bytesToRead, char *dest)
 {
-	Wire.beginTransmission(deviceAddr);
-	Wire.write(addressToRead);
-	Wire.endTransmission(false); // endTransmission but keep the connection active
-
-	Wire.requestFrom(deviceAddr, bytesToRead); // Ask for bytes, once done, bus is released by default
-
-	while (Wire.available() < bytesToRead)
-		; // Hang out until we get the # of bytes we expect
-
-	for (int x = 0; x < bytesToRead; x++)
-		dest[x] = Wire.read();
+	if (pBus == NULL || !pBus->read(deviceAddr, addressToRead, bytesToRead, dest))
+	{
+		ulErrors++;
+		return false;
+	}
+	return true;
 }
-void CJY901::writeRegister(unsigned char deviceAddr, unsigned char addressToWrite, unsigned char bytesToRead, char *dataToWrite)
+bool CJY901::writeRegister(unsigned char deviceAddr, unsigned char addressToWrite, unsigned char bytesToRead, char *dataToWrite)
 {
-	Wire.beginTransmission(deviceAddr);
-	Wire.write(addressToWrite);
-	for (int i = 0; i < bytesToRead; i++)
-		Wire.write(dataToWrite[i]);
-	Wire.endTransmission(); // Stop transmitting
+	// Not while the bus task is reading
+	lockBus();
+	bool ok = pBus != NULL && pBus->write(deviceAddr, addressToWrite, bytesToRead, dataToWrite);
+	unlockBus();
+	if (!ok)
+		ulErrors++;
+	return ok;
+}
+// Blocking reads go through the bus task too, so they never overlap an asynchronous one
+bool CJY901::ReadData(unsigned char ucAddr, unsigned char ucLength, char chrData[])
+{
+	if (!hasBusTask())
+		return readRegisters(ucDevAddr, ucAddr, ucLength, chrData);
+	if (eReadState != JY901_IDLE)
+	{
+		char chrDiscard[JY901_MAX_READ];
+		FinishRead(chrDiscard); // an asynchronous read nobody finished is dropped
+	}
+	return StartRead(ucAddr, ucLength) && FinishRead(chrData);
 }
 
 short CJY901::ReadWord(unsigned char ucAddr)
 {
-	short sResult;
-	readRegisters(ucDevAddr, ucAddr, 2, (char *)&sResult);
+	short sResult = 0;
+	ReadData(ucAddr, 2, (char *)&sResult);
 	return sResult;
 }
 void CJY901::WriteWord(unsigned char ucAddr, short sData)
 {
 	writeRegister(ucDevAddr, ucAddr, 2, (char *)&sData);
 }
-void CJY901::ReadData(unsigned char ucAddr, unsigned char ucLength, char chrData[])
+
+bool CJY901::GetTime()
+{
+	return ReadData(0x30, 8, (char *)&stcTime);
+}
+bool CJY901::GetAcc()
+{
+	return ReadData(AX, 6, (char *)&stcAcc);
+}
+bool CJY901::GetGyro()
 {
-	readRegisters(ucDevAddr, ucAddr, ucLength, chrData);
+	return ReadData(GX, 6, (char *)&stcGyro);
 }
 
-void CJY901::GetTime()
+bool CJY901::GetAngle()
 {
-	readRegisters(ucDevAddr, 0x30, 8, (char *)&stcTime);
+	return ReadData(Roll, 6, (char *)&stcAngle);
 }
-void CJY901::GetAcc()
+bool CJY901::GetMag()
 {
-	readRegisters(ucDevAddr, AX, 6, (char *)&stcAcc);
+	return ReadData(HX, 6, (char *)&stcMag);
 }
-void CJY901::GetGyro()
+bool CJY901::GetPress()
 {
-	readRegisters(ucDevAddr, GX, 6, (char *)&stcGyro);
+	return ReadData(PressureL, 8, (char *)&stcPress);
 }
-
-void CJY901::GetAngle()
+bool CJY901::GetDStatus()
+{
+	return ReadData(D0Status, 8, (char *)&stcDStatus);
+}
+bool CJY901::GetLonLat()
 {
-	readRegisters(ucDevAddr, Roll, 6, (char *)&stcAngle);
+	return ReadData(LonL, 8, (char *)&stcLonLat);
 }
-void CJY901::GetMag()
+bool CJY901::GetGPSV()
 {
-	readRegisters(ucDevAddr, HX, 6, (char *)&stcMag);
+	return ReadData(GPSHeight, 8, (char *)&stcGPSV);
 }
-void CJY901::GetPress()
+bool CJY901::GetSample()
 {
-	readRegisters(ucDevAddr, PressureL, 8, (char *)&stcPress);
+	if (!ReadData(AX, JY901_SAMPLE_BYTES, (char *)&stcSample))
+		return false;
+	copySample();
+	return true;
 }
-void CJY901::GetDStatus()
+bool CJY901::StartSample()
 {
-	readRegisters(ucDevAddr, D0Status, 8, (char *)&stcDStatus);
+	return StartRead(AX, JY901_SAMPLE_BYTES);
 }
-void CJY901::GetLonLat()
+bool CJY901::FinishSample(unsigned long ulTimeoutMs)
 {
-	readRegisters(ucDevAddr, LonL, 8, (char *)&stcLonLat);
+	if (!FinishRead((char *)&stcSample, ulTimeoutMs))
+		return false;
+	copySample();
+	return true;
 }
-void CJY901::GetGPSV()
+void CJY901::copySample()
 {
-	readRegisters(ucDevAddr, GPSHeight, 8, (char *)&stcGPSV);
+	stcSample.ulMicros = hasBusTask() ? ulReadMicros.load() : nowMicros();
+	memcpy(stcAcc.a, stcSample.a, sizeof(stcAcc.a));
+	memcpy(stcGyro.w, stcSample.w, sizeof(stcGyro.w));
+	memcpy(stcAngle.Angle, stcSample.Angle, sizeof(stcAngle.Angle));
 }
 CJY901 JY901 = CJY901();
\ No newline at end of file
@@ -1,6 +1,17 @@
 #ifndef JY901_h
 #define JY901_h
 
+#include <atomic>
+#include "JY901Bus.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
 #define SAVE 0x00
 #define CALSW 0x01
 #define RSW 0x02
@@ -72,6 +83,20 @@
 #define DIO_MODE_DOPWM 4
 #define DIO_MODE_GPS 5
 
+// Most bytes one read can return
+#define JY901_MAX_READ 32
+#define JY901_BUS_TASK_CORE 0
+#define JY901_BUS_TASK_PRIORITY 1
+#define JY901_BUS_TASK_STACK_SIZE 2048
+
+enum JY901ReadState
+{
+	JY901_IDLE,
+	JY901_BUSY,
+	JY901_DONE,
+	JY901_FAILED
+};
+
 struct STime
 {
 	unsigned char ucYear;
@@ -103,6 +128,22 @@ struct SMag
 	short T;
 };
 
+// Registers AX to Yaw read in one transaction, in register order, with the time of the read
+struct SSample
+{
+	short a[3];
+	short w[3];
+	short h[3];
+	short Angle[3];
+	unsigned long ulMicros; // micros() when the read completed
+};
+#define JY901_SAMPLE_BYTES 24 // AX to Yaw
+
+// Register units: acceleration 16 g, rate 2000 degrees/s and angle 180 degrees full scale
+#define JY901_ACC_SCALE (16.0 / 32768.0)    // g
+#define JY901_RATE_SCALE (2000.0 / 32768.0) // degrees/s
+#define JY901_ANGLE_SCALE (180.0 / 32768.0) // degrees
+
 struct SDStatus
 {
 	short sDStatus[4];
@@ -126,6 +167,31 @@ struct SGPSV
 	short sGPSYaw;
 	long lGPSVelocity;
 };
+#ifndef ARDUINO
+// The FreeRTOS binary semaphore of the bus task, off the robot
+struct JY901Signal
+{
+	std::mutex xMutex;
+	std::condition_variable xChanged;
+	bool bSet = false;
+
+	void give()
+	{
+		std::lock_guard<std::mutex> xLock(xMutex);
+		bSet = true;
+		xChanged.notify_one();
+	}
+	bool take(unsigned long ulTimeoutMs)
+	{
+		std::unique_lock<std::mutex> xLock(xMutex);
+		if (!xChanged.wait_for(xLock, std::chrono::milliseconds(ulTimeoutMs), [this]() { return bSet; }))
+			return false;
+		bSet = false;
+		return true;
+	}
+};
+#endif
+
 class CJY901
 {
 public:
@@ -138,29 +204,84 @@ public:
 	struct SPress stcPress;
 	struct SLonLat stcLonLat;
 	struct SGPSV stcGPSV;
+	struct SSample stcSample;
 
 	CJY901();
+#ifndef ARDUINO
+	~CJY901();
+#endif
+	// The bus to talk to the sensor over, Wire unless set before StartIIC
+	void SetBus(JY901Bus *pNewBus) { pBus = pNewBus; }
 	void StartIIC();
 	void StartIIC(unsigned char ucAddr);
 	void CopeSerialData(unsigned char ucData);
 	short ReadWord(unsigned char ucAddr);
 	void WriteWord(unsigned char ucAddr, short sData);
-	void ReadData(unsigned char ucAddr, unsigned char ucLength, char chrData[]);
-	void GetTime();
-	void GetAcc();
-	void GetGyro();
-	void GetAngle();
-	void GetMag();
-	void GetPress();
-	void GetDStatus();
-	void GetLonLat();
-	void GetGPSV();
+	// The reads return false when the sensor does not answer within JY901_TIMEOUT_MS,
+	// the data is left as it was
+	bool ReadData(unsigned char ucAddr, unsigned char ucLength, char chrData[]);
+	bool GetTime();
+	bool GetAcc();
+	bool GetGyro();
+	bool GetAngle();
+	bool GetMag();
+	bool GetPress();
+	bool GetDStatus();
+	bool GetLonLat();
+	bool GetGPSV();
+	// Acceleration, angular rate and angle in one transaction, into stcSample and
+	// stcAcc, stcGyro and stcAngle
+	bool GetSample();
+	bool StartSample();
+	// Collects the read of StartSample, like GetSample
+	bool FinishSample(unsigned long ulTimeoutMs = JY901_TIMEOUT_MS * 2);
+
+	// Asynchronous read: StartRead hands the transaction to the bus task and returns at once,
+	// the caller works on while the bus is busy and collects the bytes with FinishRead.
+	// StartRead fails while a read is still busy.
+	bool StartRead(unsigned char ucAddr, unsigned char ucLength);
+	JY901ReadState ReadState() const { return eReadState; }
+	// Waits up to ulTimeoutMs for the read, false when it failed or is still busy
+	bool FinishRead(char chrData[], unsigned long ulTimeoutMs = JY901_TIMEOUT_MS * 2);
+	// Failed and timed out transactions since the start
+	unsigned long GetErrorCount() const { return ulErrors; }
 
 private:
 	unsigned char ucDevAddr;
-	void readRegisters(unsigned char deviceAddr, unsigned char addressToRead, unsigned char bytesToRead, char *dest);
-	void writeRegister(unsigned char deviceAddr, unsigned char addressToWrite, unsigned char bytesToRead, char *dataToWrite);
+	JY901Bus *pBus;
+	// Read handed to the bus task, its bytes are copied out when it is done
+	unsigned char ucReadAddr;
+	unsigned char ucReadLength;
+	char chrReadBuffer[JY901_MAX_READ];
+	std::atomic<JY901ReadState> eReadState;
+	// Number of the last read started and of the last read the bus task finished
+	std::atomic<unsigned long> ulReadRequest;
+	std::atomic<unsigned long> ulReadDone;
+	std::atomic<unsigned long> ulReadMicros;
+	std::atomic<unsigned long> ulErrors;
+#ifdef ARDUINO
+	TaskHandle_t xBusTask;
+	SemaphoreHandle_t xReadDone;
+	SemaphoreHandle_t xBus;
+#else
+	// The bus task is a thread off the robot
+	std::thread xBusThread;
+	std::atomic<bool> bQuit;
+	JY901Signal xRequest;
+	JY901Signal xReadDone;
+	std::mutex xBus;
+#endif
+
+	static void busTask(void *pvParameter);
+	void startBusTask();
+	bool hasBusTask() const;
+	void lockBus();
+	void unlockBus();
+	bool waitReadDone(unsigned long ulTimeoutMs);
+	static unsigned long nowMicros();
+	void copySample();
+	bool readRegisters(unsigned char deviceAddr, unsigned char addressToRead, unsigned char bytesToRead, char *dest);
+	bool writeRegister(unsigned char deviceAddr, unsigned char addressToWrite, unsigned char bytesToRead, char *dataToWrite);
 };
 extern CJY901 JY901;
-#include <Wire.h>
 #endif
\ No newline at end of file
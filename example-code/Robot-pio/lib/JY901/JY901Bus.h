@@ -0,0 +1,121 @@
+#ifndef JY901Bus_h
+#define JY901Bus_h
+
+#include <string.h>
+
+// Longest wait for one I2C transaction, ms
+#define JY901_TIMEOUT_MS 5
+
+// The I2C bus the sensor is read over. CJY901 only talks to the bus through this,
+// so it runs against a mock bus off the robot.
+class JY901Bus
+{
+public:
+	virtual ~JY901Bus() {}
+	virtual void begin() {}
+	// Read ucLength bytes from register ucReg on, false when the device does not answer in time
+	virtual bool read(unsigned char ucDevAddr, unsigned char ucReg, unsigned char ucLength, char *chrDest) = 0;
+	virtual bool write(unsigned char ucDevAddr, unsigned char ucReg, unsigned char ucLength, const char *chrData) = 0;
+};
+
+#ifdef ARDUINO
+#include <Wire.h>
+
+// The sensor on Wire
+class JY901WireBus : public JY901Bus
+{
+public:
+	void begin() override
+	{
+		Wire.begin();
+		Wire.setTimeOut(JY901_TIMEOUT_MS); // a missing sensor fails the read instead of hanging
+	}
+
+	bool read(unsigned char ucDevAddr, unsigned char ucReg, unsigned char ucLength, char *chrDest) override
+	{
+		Wire.beginTransmission(ucDevAddr);
+		Wire.write(ucReg);
+		if (Wire.endTransmission(false) != 0) // endTransmission but keep the connection active
+			return false;
+
+		// Ask for bytes, returns what arrived within the Wire timeout, the bus is released by default
+		if (Wire.requestFrom(ucDevAddr, ucLength) != ucLength || Wire.available() < ucLength)
+		{
+			while (Wire.available() > 0)
+				Wire.read();
+			return false;
+		}
+
+		for (int x = 0; x < ucLength; x++)
+			chrDest[x] = Wire.read();
+		return true;
+	}
+
+	bool write(unsigned char ucDevAddr, unsigned char ucReg, unsigned char ucLength, const char *chrData) override
+	{
+		Wire.beginTransmission(ucDevAddr);
+		Wire.write(ucReg);
+		for (int i = 0; i < ucLength; i++)
+			Wire.write(chrData[i]);
+		return Wire.endTransmission() == 0; // Stop transmitting
+	}
+};
+#else
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// Host test double: a register map of 16 bit little endian registers, as the sensor keeps them.
+// Reads can be made to fail or to hang, to test the recovery of the sensor code.
+class JY901MockBus : public JY901Bus
+{
+public:
+	unsigned char ucDevAddr = 0x50;
+	char chrRegisters[512] = {}; // two bytes per register
+	std::atomic<unsigned long> ulReads{0};
+	std::atomic<unsigned long> ulFailNext{0}; // reads still to fail
+	std::atomic<unsigned long> ulDelayMs{0};  // time each read takes
+	unsigned char ucLastReg = 0;               // start and length of the last read
+	unsigned char ucLastLength = 0;
+
+	void setRegister(unsigned char ucReg, short sValue)
+	{
+		memcpy(&chrRegisters[ucReg * 2], &sValue, 2);
+	}
+
+	short getRegister(unsigned char ucReg) const
+	{
+		short sValue;
+		memcpy(&sValue, &chrRegisters[ucReg * 2], 2);
+		return sValue;
+	}
+
+	bool read(unsigned char ucAddr, unsigned char ucReg, unsigned char ucLength, char *chrDest) override
+	{
+		ulReads++;
+		ucLastReg = ucReg;
+		ucLastLength = ucLength;
+		if (ulDelayMs)
+			std::this_thread::sleep_for(std::chrono::milliseconds(ulDelayMs.load()));
+		if (ucAddr != ucDevAddr || ucReg * 2 + ucLength > (int)sizeof(chrRegisters))
+			return false;
+		if (ulFailNext > 0)
+		{
+			ulFailNext--;
+			return false;
+		}
+		memcpy(chrDest, &chrRegisters[ucReg * 2], ucLength);
+		return true;
+	}
+
+	bool write(unsigned char ucAddr, unsigned char ucReg, unsigned char ucLength, const char *chrData) override
+	{
+		if (ucAddr != ucDevAddr || ucReg * 2 + ucLength > (int)sizeof(chrRegisters))
+			return false;
+		memcpy(&chrRegisters[ucReg * 2], chrData, ucLength);
+		return true;
+	}
+};
+#endif
+
+#endif
@@ -0,0 +1,289 @@
+#ifndef MOTION_SERVICE_H
+#define MOTION_SERVICE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "StepScheduler.h"
+#include "SpscRing.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#endif
+
+// Motion task configuration: above the Arduino loop task (priority 1) on its core,
+// away from the IMU task on core 0
+#define MOTION_TASK_CORE 1
+#define MOTION_TASK_PRIORITY 10
+#define MOTION_TASK_STACK_SIZE 10000
+
+// Ring sizes, powers of two
+#define MOTION_QUEUE_LENGTH 16
+#define MOTION_COMPLETION_LENGTH 16
+
+// Microsecond clock shared by the motion timestamps
+inline uint32_t motionMicros()
+{
+#ifdef ARDUINO
+    return micros();
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+enum MotionType : uint8_t
+{
+    MOTION_MOVE = 0,
+    MOTION_MOVE_BLENDED = 1,
+    MOTION_TURN = 2,
+    MOTION_STOP = 3,
+    MOTION_ARC = 4
+};
+
+struct MotionCommand
+{
+    uint32_t id;
+    MotionType type;
+    double value;               // mm, degrees or ms
+    const StepProfile *profile; // precomputed ramp or null
+    const long *distances;      // moves of a blended run, must outlive the command
+    size_t count;               // entries in distances
+    double radius;              // arc radius, mm
+    uint32_t duration;          // time to take for a move or arc, ms, 0 for full speed
+    uint32_t enqueuedAt;        // motionMicros() at submit
+};
+
+// Timing of a finished command, us on the motionMicros() clock
+struct MotionCompletion
+{
+    uint32_t id;
+    uint32_t enqueuedAt;
+    uint32_t startedAt;   // taken off the queue by the motion task
+    uint32_t firstStepAt; // first step pulse, 0 if the command did not step
+    uint32_t finishedAt;
+    bool finished; // false when the command was refused or cut short
+};
+
+// Runs motion commands on the motion task, implemented by Robot
+class MotionExecutor
+{
+public:
+    // Returns false when the command was refused or cut short
+    virtual bool executeMotion(const MotionCommand &command) = 0;
+    // Time of the first step pulse of the last command, 0 if none
+    virtual uint32_t firstStepTime() { return 0; }
+    virtual ~MotionExecutor() {}
+};
+
+class MotionService;
+
+// Completion handle of a submitted command, cheap to copy
+class MotionHandle
+{
+private:
+    const MotionService *_service;
+    uint32_t _id;
+
+public:
+    MotionHandle(const MotionService *service = nullptr, uint32_t id = 0) : _service(service), _id(id) {}
+
+    bool isValid() const { return _service != nullptr; }
+    uint32_t id() const { return _id; }
+    inline bool isDone() const;
+    // Wait until done, returns false on timeout
+    inline bool wait(unsigned long timeoutMs = 0xFFFFFFFFUL) const;
+};
+
+// Motion commands executed one at a time by a dedicated motion task.
+// Commands go in through one lock-free ring and timings come back through another,
+// so neither side ever takes a mutex. Commands complete in submission order, so a
+// handle is done once the completed count has reached its id.
+// Submit and read completions from one task only.
+class MotionService
+{
+private:
+    MotionExecutor *_executor = nullptr;
+    uint32_t _nextId = 1;
+    std::atomic<uint32_t> _completed{0};
+    std::atomic<uint32_t> _droppedCompletions{0};
+    SpscRing<MotionCommand, MOTION_QUEUE_LENGTH> _commands;
+    SpscRing<MotionCompletion, MOTION_COMPLETION_LENGTH> _completions;
+
+#ifdef ARDUINO
+    TaskHandle_t _task = NULL;
+
+    static void motionTask(void *parameter)
+    {
+        MotionService *service = (MotionService *)parameter;
+        MotionCommand command;
+        while (true)
+        {
+            // The notification is only a wake-up, the ring holds the commands
+            while (!service->_commands.pop(&command))
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            service->run(command);
+        }
+    }
+#else
+    std::thread _worker;
+    std::atomic<bool> _quit{false};
+
+    void workerLoop()
+    {
+        MotionCommand command;
+        while (true)
+        {
+            if (_commands.pop(&command))
+                run(command);
+            else if (_quit.load())
+                return;
+            else
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+#endif
+
+    void run(const MotionCommand &command)
+    {
+        MotionCompletion completion;
+        completion.id = command.id;
+        completion.enqueuedAt = command.enqueuedAt;
+        completion.startedAt = motionMicros();
+        completion.finished = _executor->executeMotion(command);
+        completion.firstStepAt = _executor->firstStepTime();
+        completion.finishedAt = motionMicros();
+
+        if (!_completions.push(completion))
+            _droppedCompletions.fetch_add(1, std::memory_order_relaxed);
+        _completed.store(command.id, std::memory_order_release);
+    }
+
+public:
+#ifndef ARDUINO
+    ~MotionService()
+    {
+        if (_worker.joinable())
+        {
+            _quit.store(true);
+            _worker.join();
+        }
+    }
+#endif
+
+    // Start the motion task, commands run on it through executor
+    void begin(MotionExecutor *executor)
+    {
+        _executor = executor;
+#ifdef ARDUINO
+        if (_task != NULL)
+            return;
+        xTaskCreatePinnedToCore(
+            motionTask,             // Task function
+            "Motion_Task",          // Task name
+            MOTION_TASK_STACK_SIZE, // Stack size
+            this,                   // Task parameters
+            MOTION_TASK_PRIORITY,   // Priority
+            &_task,                 // Task handle
+            MOTION_TASK_CORE        // Core ID
+        );
+#else
+        if (!_worker.joinable())
+            _worker = std::thread(&MotionService::workerLoop, this);
+#endif
+    }
+
+    bool isStarted() const
+    {
+#ifdef ARDUINO
+        return _task != NULL;
+#else
+        return _worker.joinable();
+#endif
+    }
+
+    // Queue a command and return at once. Waits only while the ring is full.
+    MotionHandle submit(MotionType type, double value, const StepProfile *profile = nullptr,
+                        const long *distances = nullptr, size_t count = 0, double radius = 0,
+                        uint32_t duration = 0)
+    {
+        MotionCommand command = {_nextId++, type, value, profile, distances, count, radius, duration, motionMicros()};
+        while (!_commands.push(command))
+        {
+#ifdef ARDUINO
+            vTaskDelay(1);
+#else
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+        }
+#ifdef ARDUINO
+        xTaskNotifyGive(_task);
+#endif
+        return MotionHandle(this, command.id);
+    }
+
+    // Timing of the next finished command, false when there is none
+    bool popCompletion(MotionCompletion *completion)
+    {
+        return _completions.pop(completion);
+    }
+
+    uint32_t droppedCompletions() const { return _droppedCompletions.load(std::memory_order_relaxed); }
+    uint32_t completed() const { return _completed.load(std::memory_order_acquire); }
+    bool isIdle() const { return completed() == _nextId - 1; }
+};
+
+inline bool MotionHandle::isDone() const
+{
+    return _service == nullptr || _service->completed() >= _id;
+}
+
+inline bool MotionHandle::wait(unsigned long timeoutMs) const
+{
+#ifdef ARDUINO
+    unsigned long startTime = millis();
+    while (!isDone())
+    {
+        if (millis() - startTime > timeoutMs)
+            return false;
+        vTaskDelay(1);
+    }
+#else
+    auto startTime = std::chrono::steady_clock::now();
+    while (!isDone())
+    {
+        if (std::chrono::steady_clock::now() - startTime > std::chrono::milliseconds(timeoutMs))
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+#endif
+    return true;
+}
+
+#ifndef ARDUINO
+// Host test double: records every command and takes a fixed time per command
+class RecordingMotionExecutor : public MotionExecutor
+{
+public:
+    std::vector<MotionCommand> commands;
+    unsigned long durationMs = 0;
+    std::mutex mutex;
+
+    bool executeMotion(const MotionCommand &command) override
+    {
+        if (durationMs)
+            std::this_thread::sleep_for(std::chrono::milliseconds(durationMs));
+        std::lock_guard<std::mutex> lock(mutex);
+        commands.push_back(command);
+        return true;
+    }
+};
+#endif
+
+#endif
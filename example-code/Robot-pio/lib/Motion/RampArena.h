@@ -0,0 +1,88 @@
+#ifndef RAMP_ARENA_H
+#define RAMP_ARENA_H
+
+#include <stdint.h>
+#include "StepScheduler.h"
+#include "SCurve.h"
+
+// Ramp intervals held for one command sequence (2 bytes each)
+#define RAMP_ARENA_SIZE 16384
+// Distinct ramps held for one command sequence
+#define RAMP_ARENA_ENTRIES 64
+
+// Step interval tables for a whole command sequence, built once when the sequence
+// is loaded so running it is table lookups only.
+// Commands with the same profile limits share one table.
+class RampArena
+{
+private:
+    struct Entry
+    {
+        float speed;
+        float acceleration;
+        float jerk;
+        StepProfile profile;
+    };
+
+    uint16_t _pool[RAMP_ARENA_SIZE];
+    uint32_t _used = 0;
+    Entry _entries[RAMP_ARENA_ENTRIES];
+    uint8_t _count = 0;
+
+public:
+    void clear()
+    {
+        _used = 0;
+        _count = 0;
+    }
+
+    // Profile for a move of steps with the given limits, a jerk of 0 for a trapezoid.
+    // Returns false when the arena is full, the caller should then build the ramp at run time.
+    bool plan(uint32_t steps, float speed, float acceleration, float jerk, StepProfile *profile)
+    {
+        // A trapezoid mirrors cleanly at any length, an S-curve needs a lower peak on short moves
+        if (jerk > 0)
+            speed = sCurvePeakSpeed(steps, speed, acceleration, jerk);
+
+        for (uint8_t i = 0; i < _count; i++)
+        {
+            const Entry &e = _entries[i];
+            if (e.speed == speed && e.acceleration == acceleration && e.jerk == jerk)
+            {
+                *profile = e.profile;
+                profile->steps = steps;
+                return true;
+            }
+        }
+
+        if (_count == RAMP_ARENA_ENTRIES || _used == RAMP_ARENA_SIZE)
+            return false;
+
+        Entry &e = _entries[_count];
+        e.speed = speed;
+        e.acceleration = acceleration;
+        e.jerk = jerk;
+        e.profile.ramp = &_pool[_used];
+
+        uint32_t space = RAMP_ARENA_SIZE - _used;
+        if (jerk > 0)
+            e.profile.rampSteps = buildSCurveRamp(speed, acceleration, jerk, &_pool[_used], space, &e.profile.cruiseInterval);
+        else
+            e.profile.rampSteps = buildStepRamp(speed, acceleration, &_pool[_used], space, &e.profile.cruiseInterval);
+
+        // A ramp cut short by the end of the pool would change the motion
+        if (e.profile.rampSteps == space)
+            return false;
+
+        _used += e.profile.rampSteps;
+        _count++;
+        *profile = e.profile;
+        profile->steps = steps;
+        return true;
+    }
+
+    uint32_t used() const { return _used; }
+    uint8_t count() const { return _count; }
+};
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef SCURVE_H
+#define SCURVE_H
+
+#include <stdint.h>
+#include <math.h>
+#include "StepScheduler.h"
+
+// Jerk limited (S-curve) acceleration from standstill to a cruise speed.
+// Units are steps, steps/s, steps/s^2 and steps/s^3.
+//   phase 1: acceleration rises at jerk up to the peak acceleration
+//   phase 2: constant peak acceleration (skipped when the speed is too low to reach it)
+//   phase 3: acceleration falls at jerk back to zero at the cruise speed
+struct SCurve
+{
+    float speed;
+    float jerk;
+    float peakAccel;
+    float t1; // length of phases 1 and 3, s
+    float t2; // length of phase 2, s
+
+    SCurve(float speed, float accel, float jerk) : speed(speed), jerk(jerk)
+    {
+        if (speed * jerk < accel * accel)
+        {
+            peakAccel = sqrtf(speed * jerk);
+            t2 = 0;
+        }
+        else
+        {
+            peakAccel = accel;
+            t2 = speed / accel - accel / jerk;
+        }
+        t1 = peakAccel / jerk;
+    }
+
+    // The velocity curve is point symmetric about its middle, so the average speed is half the cruise speed
+    float rampTime() const { return 2 * t1 + t2; }
+    float rampDistance() const { return speed * rampTime() / 2; }
+
+    // Position and velocity at time t from the start of the ramp, cruising after the ramp
+    float position(float t, float *velocity) const
+    {
+        float v1 = jerk * t1 * t1 / 2;
+        float s1 = jerk * t1 * t1 * t1 / 6;
+        if (t <= t1)
+        {
+            *velocity = jerk * t * t / 2;
+            return jerk * t * t * t / 6;
+        }
+
+        float tau = t - t1;
+        if (tau <= t2)
+        {
+            *velocity = v1 + peakAccel * tau;
+            return s1 + v1 * tau + peakAccel * tau * tau / 2;
+        }
+
+        float v2 = v1 + peakAccel * t2;
+        float s2 = s1 + v1 * t2 + peakAccel * t2 * t2 / 2;
+        tau -= t2;
+        if (tau <= t1)
+        {
+            *velocity = v2 + peakAccel * tau - jerk * tau * tau / 2;
+            return s2 + v2 * tau + peakAccel * tau * tau / 2 - jerk * tau * tau * tau / 6;
+        }
+
+        *velocity = speed;
+        return rampDistance() + speed * (tau - t1);
+    }
+};
+
+// Highest cruise speed, at most speed, whose S-curve ramps up and back down within distance steps
+inline float sCurvePeakSpeed(float distance, float speed, float accel, float jerk)
+{
+    if (SCurve(speed, accel, jerk).rampDistance() * 2 <= distance)
+        return speed;
+
+    float low = 0;
+    float high = speed;
+    for (int i = 0; i < 24; i++)
+    {
+        float mid = (low + high) / 2;
+        if (SCurve(mid, accel, jerk).rampDistance() * 2 <= distance)
+            low = mid;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+// Time in s to move steps from rest to rest with the given limits, a jerk of 0 for a trapezoid
+inline float profileMoveTime(float steps, float speed, float accel, float jerk)
+{
+    if (steps <= 0)
+        return 0;
+
+    if (jerk > 0)
+    {
+        float peak = sCurvePeakSpeed(steps, speed, accel, jerk);
+        SCurve curve(peak, accel, jerk);
+        return 2 * curve.rampTime() + (steps - 2 * curve.rampDistance()) / peak;
+    }
+
+    float rampDistance = speed * speed / (2 * accel);
+    if (steps >= 2 * rampDistance)
+        return steps / speed + speed / accel;
+    return 2 * sqrtf(steps / accel);
+}
+
+// Cruise speed, at most speed, that moves steps from rest to rest in time s with the given limits.
+// Returns speed when the move cannot be done that fast.
+inline float profileSpeedForTime(float steps, float time, float speed, float accel, float jerk)
+{
+    if (steps <= 0 || profileMoveTime(steps, speed, accel, jerk) >= time)
+        return speed;
+
+    // The move time falls as the cruise speed rises
+    float low = 0;
+    float high = speed;
+    for (int i = 0; i < 24; i++)
+    {
+        float mid = (low + high) / 2;
+        if (profileMoveTime(steps, mid, accel, jerk) > time)
+            low = mid;
+        else
+            high = mid;
+    }
+    return high;
+}
+
+// Fill ramp with the step intervals of an S-curve from standstill to speed.
+// Each step time is found by Newton iteration on the position curve.
+// Returns the number of entries written, cruiseInterval receives the interval at full speed.
+inline uint32_t buildSCurveRamp(float speed, float accel, float jerk,
+                                uint16_t *ramp, uint32_t maxSteps, uint32_t *cruiseInterval)
+{
+    if (speed > 1000000.0f / STEP_MIN_INTERVAL_US)
+        speed = 1000000.0f / STEP_MIN_INTERVAL_US;
+
+    SCurve curve(speed, accel, jerk);
+    float rampDistance = curve.rampDistance();
+    uint32_t n = 0;
+    float last = 0;
+
+    while (n < maxSteps && n + 1 <= rampDistance)
+    {
+        float target = n + 1;
+        // Closed form inside phase 1, a good start for Newton everywhere else
+        float t = cbrtf(6 * target / jerk);
+        if (t > curve.t1)
+            t = last + (n > 0 ? ramp[n - 1] / 1000000.0f : t);
+
+        for (int i = 0; i < 8; i++)
+        {
+            float v;
+            float s = curve.position(t, &v);
+            if (v <= 0)
+                break;
+            float dt = (target - s) / v;
+            t += dt;
+            if (fabsf(dt) < 0.0000001f)
+                break;
+        }
+
+        float interval = (t - last) * 1000000.0f;
+        ramp[n] = interval > STEP_MAX_INTERVAL_US ? STEP_MAX_INTERVAL_US : (uint16_t)lroundf(interval);
+        last = t;
+        n++;
+    }
+
+    // A truncated ramp cruises at the last speed it reached
+    *cruiseInterval = (n == maxSteps && n > 0) ? ramp[n - 1] : (uint32_t)lroundf(1000000.0f / speed);
+    return n;
+}
+
+#endif
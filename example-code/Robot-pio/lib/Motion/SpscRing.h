@@ -0,0 +1,56 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// Lock-free ring buffer for exactly one producer and one consumer task.
+// Each index is written by one side only, so no lock is needed: the release
+// store of an index publishes the item, the acquire load on the other side sees it.
+// N must be a power of two.
+template <typename T, uint32_t N>
+class SpscRing
+{
+private:
+    static_assert((N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+    T _items[N];
+    std::atomic<uint32_t> _head{0}; // next slot to write, owned by the producer
+    std::atomic<uint32_t> _tail{0}; // next slot to read, owned by the consumer
+
+public:
+    // Producer side, returns false when full
+    bool push(const T &item)
+    {
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        if (head - _tail.load(std::memory_order_acquire) == N)
+            return false;
+        _items[head & (N - 1)] = item;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side, returns false when empty
+    bool pop(T *item)
+    {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        if (_head.load(std::memory_order_acquire) == tail)
+            return false;
+        *item = _items[tail & (N - 1)];
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool isEmpty() const
+    {
+        return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+    }
+
+    uint32_t size() const
+    {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+};
+
+#endif
@@ -0,0 +1,391 @@
+#ifndef STEP_ENGINE_H
+#define STEP_ENGINE_H
+
+#include "StepScheduler.h"
+#include "SCurve.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+// Hardware timer used for step generation, 80 MHz APB / 80 = 1 us per tick
+#define STEP_TIMER_ID 0
+#define STEP_TIMER_DIVIDER 80
+
+// Minimum lead time when re-arming an alarm that is already late, us
+#define STEP_TIMER_MIN_LEAD 2
+
+// Longest acceleration ramp kept for a move
+#define STEP_RAMP_MAX 4096
+
+// Emits step pulses for both wheels from a hardware timer interrupt.
+// On the host the timer is virtual and time only moves when advance() is called.
+class StepEngine
+{
+private:
+    StepScheduler _scheduler;
+    uint8_t _stepPins[STEP_CHANNELS] = {};
+    uint8_t _dirPins[STEP_CHANNELS] = {};
+    uint8_t _raised = 0;
+
+    // Acceleration ramp shared by both wheels
+    uint16_t _ramp[STEP_RAMP_MAX];
+    uint32_t _rampSteps = 0;
+    uint32_t _cruiseInterval = 0;
+    float _speed = 0;
+    float _acceleration = 0;
+    float _jerk = 0;
+    bool _rampShortened = false; // ramp was rebuilt for a move too short to reach _speed
+
+    uint64_t _alarmAt = 0; // absolute timer count of the next tick
+    volatile uint32_t _firstStepAt = 0; // micros() of the first pulse since clearFirstStep, virtual us on the host
+
+#ifdef ARDUINO
+    hw_timer_t *_timer = nullptr;
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+    static StepEngine *_instance;
+
+    static void IRAM_ATTR onTimer()
+    {
+        _instance->service();
+    }
+
+    void lock() { portENTER_CRITICAL(&_lock); }
+    void unlock() { portEXIT_CRITICAL(&_lock); }
+#else
+    uint64_t _virtualNow = 0;
+    bool _armed = false;
+    void (*_pulseHook)(uint8_t mask, uint64_t timeUs, void *context) = nullptr;
+    void *_pulseContext = nullptr;
+
+    void lock() {}
+    void unlock() {}
+#endif
+
+    STEP_ISR_ATTR void writePin(uint8_t pin, bool high)
+    {
+#ifdef ARDUINO
+        digitalWrite(pin, high ? HIGH : LOW);
+#else
+        (void)pin;
+        (void)high;
+#endif
+    }
+
+    void setDirection(uint8_t channel, int8_t direction)
+    {
+        writePin(_dirPins[channel], direction > 0);
+    }
+
+    // Timer tick: end the previous pulses, raise the due ones and re-arm the alarm
+    STEP_ISR_ATTR void service()
+    {
+#ifdef ARDUINO
+        portENTER_CRITICAL_ISR(&_lock);
+#endif
+        for (uint8_t i = 0; i < STEP_CHANNELS; i++)
+        {
+            if (_raised & (1 << i))
+                writePin(_stepPins[i], false);
+        }
+
+        uint32_t nextDelay;
+        _raised = _scheduler.tick(&nextDelay);
+        if (_raised && _firstStepAt == 0)
+        {
+#ifdef ARDUINO
+            _firstStepAt = micros();
+#else
+            _firstStepAt = (uint32_t)_alarmAt;
+#endif
+        }
+
+        for (uint8_t i = 0; i < STEP_CHANNELS; i++)
+        {
+            if (_raised & (1 << i))
+                writePin(_stepPins[i], true);
+        }
+#ifndef ARDUINO
+        if (_raised && _pulseHook)
+            _pulseHook(_raised, _alarmAt, _pulseContext);
+#endif
+
+        if (nextDelay)
+            arm(_alarmAt + nextDelay);
+#ifdef ARDUINO
+        portEXIT_CRITICAL_ISR(&_lock);
+#endif
+    }
+
+    STEP_ISR_ATTR void arm(uint64_t at)
+    {
+        _alarmAt = at;
+#ifdef ARDUINO
+        // A tick that ran late must not set an alarm the counter has already passed
+        uint64_t now = timerRead(_timer);
+        if (at < now + STEP_TIMER_MIN_LEAD)
+            at = now + STEP_TIMER_MIN_LEAD;
+        timerAlarmWrite(_timer, at, false);
+        timerAlarmEnable(_timer);
+#else
+        _armed = true;
+#endif
+    }
+
+    uint64_t timerNow()
+    {
+#ifdef ARDUINO
+        return timerRead(_timer);
+#else
+        return _virtualNow;
+#endif
+    }
+
+    void startScheduler()
+    {
+#ifdef ARDUINO
+        if (_timer == nullptr)
+        {
+            // Created on first use, the timer driver is not ready during static initialization
+            _instance = this;
+            _timer = timerBegin(STEP_TIMER_ID, STEP_TIMER_DIVIDER, true);
+            timerAttachInterrupt(_timer, &StepEngine::onTimer, true);
+        }
+#endif
+        uint32_t firstDelay = _scheduler.start();
+        if (firstDelay)
+            arm(timerNow() + firstDelay);
+    }
+
+    void buildRamp(float speed)
+    {
+        if (_jerk > 0)
+            _rampSteps = buildSCurveRamp(speed, _acceleration, _jerk, _ramp, STEP_RAMP_MAX, &_cruiseInterval);
+        else
+            _rampSteps = buildStepRamp(speed, _acceleration, _ramp, STEP_RAMP_MAX, &_cruiseInterval);
+    }
+
+    // An S-curve cut off at the middle of a short move would reverse the acceleration
+    // in one step, so short moves get a ramp with a lower peak speed that ends at zero acceleration
+    void fitRamp(uint32_t steps)
+    {
+        if (_jerk <= 0)
+            return;
+
+        float peak = sCurvePeakSpeed(steps, _speed, _acceleration, _jerk);
+        if (peak < _speed)
+        {
+            buildRamp(peak);
+            _rampShortened = true;
+        }
+        else if (_rampShortened)
+        {
+            buildRamp(_speed);
+            _rampShortened = false;
+        }
+    }
+
+    static uint32_t speedToInterval(float speed)
+    {
+        float interval = 1000000.0f / fabsf(speed);
+        if (interval > STEP_MAX_INTERVAL_US)
+            return STEP_MAX_INTERVAL_US;
+        if (interval < STEP_MIN_INTERVAL_US)
+            return STEP_MIN_INTERVAL_US;
+        return (uint32_t)lroundf(interval);
+    }
+
+public:
+    void begin(uint8_t leftStepPin, uint8_t leftDirPin, uint8_t rightStepPin, uint8_t rightDirPin)
+    {
+        _stepPins[STEP_LEFT] = leftStepPin;
+        _dirPins[STEP_LEFT] = leftDirPin;
+        _stepPins[STEP_RIGHT] = rightStepPin;
+        _dirPins[STEP_RIGHT] = rightDirPin;
+#ifdef ARDUINO
+        for (uint8_t i = 0; i < STEP_CHANNELS; i++)
+        {
+            pinMode(_stepPins[i], OUTPUT);
+            pinMode(_dirPins[i], OUTPUT);
+            digitalWrite(_stepPins[i], LOW);
+        }
+#endif
+    }
+
+    // Set the maximum speed (steps/s), acceleration (steps/s^2) and jerk (steps/s^3) of the next moves.
+    // A jerk of 0 gives a trapezoid profile, otherwise an S-curve.
+    // The ramp is only rebuilt when they change.
+    void configure(float speed, float acceleration, float jerk = 0)
+    {
+        if (speed == _speed && acceleration == _acceleration && jerk == _jerk && !_rampShortened)
+            return;
+        _speed = speed;
+        _acceleration = acceleration;
+        _jerk = jerk;
+        _rampShortened = false;
+        stop();
+        buildRamp(speed);
+    }
+
+    // Start a move with the configured profile. Returns immediately, the steps run from the timer.
+    // Both wheels share one profile, the wheel with fewer steps is spread evenly over it.
+    void start(long leftSteps, long rightSteps)
+    {
+        stop();
+        fitRamp(labs(leftSteps) > labs(rightSteps) ? labs(leftSteps) : labs(rightSteps));
+
+        StepProfile profile;
+        profile.ramp = _ramp;
+        profile.rampSteps = _rampSteps;
+        profile.cruiseInterval = _cruiseInterval;
+        start(leftSteps, rightSteps, profile);
+    }
+
+    // Start a move with a precomputed profile, the ramp it points to must outlive the move
+    void start(long leftSteps, long rightSteps, const StepProfile &profile)
+    {
+        stop();
+        long steps[STEP_CHANNELS] = {leftSteps, rightSteps};
+        _scheduler.load(profile, steps);
+        for (uint8_t i = 0; i < STEP_CHANNELS; i++)
+            setDirection(i, _scheduler.direction(i));
+        startScheduler();
+    }
+
+    // Run both wheels at a constant signed speed (steps/s) until changed or stopped.
+    // A running move switches over without stopping, keeping its direction.
+    void setSpeed(float leftSpeed, float rightSpeed)
+    {
+        float speeds[STEP_CHANNELS] = {fabsf(leftSpeed), fabsf(rightSpeed)};
+        float fastest = speeds[0] > speeds[1] ? speeds[0] : speeds[1];
+        if (fastest == 0)
+        {
+            stop();
+            return;
+        }
+
+        uint32_t rates[STEP_CHANNELS];
+        int8_t directions[STEP_CHANNELS] = {(int8_t)(leftSpeed < 0 ? -1 : 1), (int8_t)(rightSpeed < 0 ? -1 : 1)};
+        for (uint8_t i = 0; i < STEP_CHANNELS; i++)
+            rates[i] = (uint32_t)lroundf(speeds[i] / fastest * STEP_RATE_ONE);
+
+        lock();
+        bool running = _scheduler.isRunning();
+        if (running)
+        {
+            _scheduler.loadContinuous(speedToInterval(fastest), rates, directions);
+            // The tick armed at the old speed would hold the new one back by up to a whole slow step.
+            // Brought forward it may already be overdue, it is then due now so the steps keep their spacing.
+            uint32_t earlier = _scheduler.hastenNextTick();
+            if (earlier)
+            {
+                uint64_t at = _alarmAt - earlier;
+                uint64_t now = timerNow();
+                arm(at > now ? at : now + STEP_TIMER_MIN_LEAD);
+            }
+        }
+        unlock();
+        if (running)
+            return;
+
+        _scheduler.loadContinuous(speedToInterval(fastest), rates, directions);
+        for (uint8_t i = 0; i < STEP_CHANNELS; i++)
+            setDirection(i, directions[i]);
+        startScheduler();
+    }
+
+    // Scale the wheel speeds of the running move, 1 for no change, to steer while moving
+    void setTrim(float left, float right)
+    {
+        float trims[STEP_CHANNELS] = {left, right};
+        lock();
+        for (uint8_t i = 0; i < STEP_CHANNELS; i++)
+        {
+            float trim = trims[i] > 1 ? 1 : (trims[i] < 0 ? 0 : trims[i]);
+            _scheduler.setTrim(i, (uint32_t)lroundf(trim * STEP_RATE_ONE));
+        }
+        unlock();
+    }
+
+    // Stop after the current step and wait for the timer to finish.
+    // The last step can be up to STEP_MAX_INTERVAL_US away, the caller sleeps
+    // a tick at a time so lower priority tasks run meanwhile.
+    void stop()
+    {
+        lock();
+        _scheduler.stop();
+        unlock();
+        while (_scheduler.isRunning())
+        {
+#ifdef ARDUINO
+            vTaskDelay(1);
+#else
+            advance(STEP_PULSE_END_US);
+#endif
+        }
+    }
+
+    bool isRunning() const { return _scheduler.isRunning(); }
+
+    // Latency instrumentation: time of the first step pulse after clearFirstStep, 0 if none yet
+    void clearFirstStep() { _firstStepAt = 0; }
+    uint32_t firstStepTime() const { return _firstStepAt; }
+
+    // Signed steps emitted since the last start
+    long position(uint8_t channel) const
+    {
+        return (long)_scheduler.stepsDone(channel) * _scheduler.direction(channel);
+    }
+
+    // Fraction of the current move completed, 0 to 1
+    float progress() const { return _scheduler.progress(); }
+
+    // Current signed speed in steps/s
+    float speed(uint8_t channel) const
+    {
+        uint32_t interval = _scheduler.currentInterval();
+        if (!_scheduler.isRunning() || interval == 0)
+            return 0;
+        return 1000000.0f / interval * _scheduler.rate(channel) * _scheduler.direction(channel);
+    }
+
+#ifndef ARDUINO
+    // Virtual timer: run every tick due in the next us microseconds
+    void advance(uint64_t us)
+    {
+        uint64_t until = _virtualNow + us;
+        while (_armed && _alarmAt <= until)
+        {
+            _virtualNow = _alarmAt;
+            _armed = false;
+            service();
+        }
+        _virtualNow = until;
+    }
+
+    void runUntilIdle()
+    {
+        while (_armed)
+        {
+            _virtualNow = _alarmAt;
+            _armed = false;
+            service();
+        }
+    }
+
+    uint64_t virtualNow() const { return _virtualNow; }
+
+    // Called for every tick that raises step pulses, with the virtual time in us
+    void setPulseHook(void (*hook)(uint8_t mask, uint64_t timeUs, void *context), void *context)
+    {
+        _pulseHook = hook;
+        _pulseContext = context;
+    }
+#endif
+};
+
+#ifdef ARDUINO
+StepEngine *StepEngine::_instance = nullptr;
+#endif
+
+#endif
@@ -0,0 +1,275 @@
+#ifndef STEP_SCHEDULER_H
+#define STEP_SCHEDULER_H
+
+#include <stdint.h>
+#include <math.h>
+
+// Code called from the step timer interrupt must live in IRAM on the ESP32
+#ifdef ARDUINO
+#include <esp_attr.h>
+#define STEP_ISR_ATTR IRAM_ATTR
+#else
+#define STEP_ISR_ATTR
+#endif
+
+// Wheel channels
+#define STEP_LEFT 0
+#define STEP_RIGHT 1
+#define STEP_CHANNELS 2
+
+// Delay before the extra tick that lowers the last step pulse of a move
+#define STEP_PULSE_END_US 10
+
+// Longest and shortest step interval the engine will schedule
+#define STEP_MAX_INTERVAL_US 65535
+#define STEP_MIN_INTERVAL_US 20
+
+// Profile step count of a move that runs until stopped
+#define STEP_CONTINUOUS 0xFFFFFFFFUL
+
+// Fixed point one for the step rate of a wheel relative to the profile
+#define STEP_RATE_ONE 65536UL
+
+// Precomputed velocity profile shared by both wheels, in steps of the faster wheel
+struct StepProfile
+{
+    uint32_t steps;          // total steps of the faster wheel
+    const uint16_t *ramp;    // acceleration intervals in us, ramp[0] is the first step
+    uint32_t rampSteps;      // entries in ramp
+    uint32_t cruiseInterval; // interval in us once the ramp is used up
+};
+
+// Fill ramp with the step intervals of a constant acceleration ramp from
+// standstill to speed (steps/s), using the same recurrence as AccelStepper.
+// Returns the number of entries written, cruiseInterval receives the interval at full speed.
+inline uint32_t buildStepRamp(float speed, float acceleration,
+                              uint16_t *ramp, uint32_t maxSteps, uint32_t *cruiseInterval)
+{
+    float cmin = 1000000.0f / speed;
+    if (cmin < STEP_MIN_INTERVAL_US)
+        cmin = STEP_MIN_INTERVAL_US;
+
+    float cn = 0.676f * sqrtf(2.0f / acceleration) * 1000000.0f;
+    uint32_t n = 0;
+    while (n < maxSteps && cn > cmin)
+    {
+        ramp[n] = cn > STEP_MAX_INTERVAL_US ? STEP_MAX_INTERVAL_US : (uint16_t)lroundf(cn);
+        n++;
+        cn = cn - 2.0f * cn / (4.0f * n + 1.0f);
+    }
+
+    // A truncated ramp cruises at the last speed it reached
+    *cruiseInterval = (n == maxSteps && n > 0) ? ramp[n - 1] : (uint32_t)lroundf(cmin);
+    return n;
+}
+
+// Step timing for both wheels, driven by a one-shot timer.
+// Every tick is one step of the profile. Each wheel steps on the ticks picked by a
+// Bresenham accumulator, so the wheels stay within half a step of their exact ratio
+// through the whole move, ramps included.
+// Knows nothing about pins or the timer itself so it can run on a virtual clock.
+class StepScheduler
+{
+private:
+    struct Channel
+    {
+        uint32_t rate;     // steps per profile step, as a fraction of _denominator
+        uint32_t baseRate; // rate before trimming
+        uint32_t acc;     // Bresenham accumulator
+        uint32_t done;    // steps emitted
+        int8_t direction; // 1 or -1
+    };
+
+    StepProfile _profile = {};
+    Channel _channels[STEP_CHANNELS] = {};
+    uint32_t _denominator = 1;
+    uint32_t _baseTotal = 1; // sum of the untrimmed rates
+    uint32_t _owed = 0;      // steps skipped by trimming not yet made up, in _denominator units
+    uint32_t _done = 0;     // profile steps completed
+    uint32_t _interval = 0; // interval that scheduled the next tick, us
+    uint32_t _now = 0;      // nominal time of the current tick, us
+    uint32_t _decelIndex = UINT32_MAX; // lowest ramp entry the deceleration has reached
+    bool _finishing = false;
+    volatile bool _running = false;
+
+    // Interval before profile step k: the ramp is mirrored for deceleration
+    STEP_ISR_ATTR uint32_t intervalFor(uint32_t k) const
+    {
+        uint32_t fromEnd = _profile.steps - 1 - k;
+        uint32_t idx = k < fromEnd ? k : fromEnd;
+        if (idx > _decelIndex)
+            idx = _decelIndex;
+        return idx < _profile.rampSteps ? _profile.ramp[idx] : _profile.cruiseInterval;
+    }
+
+    void setRates(const uint32_t rates[STEP_CHANNELS], uint32_t denominator)
+    {
+        _denominator = denominator;
+        _baseTotal = 0;
+        for (uint8_t i = 0; i < STEP_CHANNELS; i++)
+        {
+            _baseTotal += rates[i];
+            _channels[i].rate = rates[i];
+            _channels[i].baseRate = rates[i];
+            // Start half way so the slower wheel is rounded to the nearest step
+            _channels[i].acc = denominator / 2;
+        }
+        if (_baseTotal == 0)
+            _baseTotal = 1;
+    }
+
+public:
+    // Load a move of the given signed steps per wheel. The wheel with more steps
+    // follows the profile, whose step count is set from it.
+    void load(const StepProfile &profile, const long steps[STEP_CHANNELS])
+    {
+        uint32_t rates[STEP_CHANNELS];
+        uint32_t longest = 0;
+        for (uint8_t i = 0; i < STEP_CHANNELS; i++)
+        {
+            rates[i] = steps[i] < 0 ? -steps[i] : steps[i];
+            _channels[i].direction = steps[i] < 0 ? -1 : 1;
+            if (rates[i] > longest)
+                longest = rates[i];
+        }
+        _profile = profile;
+        _profile.steps = longest;
+        setRates(rates, longest ? longest : 1);
+    }
+
+    // Load continuous stepping: the profile runs at interval and each wheel steps at
+    // rates[i] / STEP_RATE_ONE of it. When running the change applies from the next step,
+    // see hastenNextTick for a speed increase.
+    void loadContinuous(uint32_t interval, const uint32_t rates[STEP_CHANNELS], const int8_t directions[STEP_CHANNELS])
+    {
+        _profile.steps = STEP_CONTINUOUS;
+        _profile.ramp = nullptr;
+        _profile.rampSteps = 0;
+        _profile.cruiseInterval = interval;
+        if (!_running)
+        {
+            for (uint8_t i = 0; i < STEP_CHANNELS; i++)
+                _channels[i].direction = directions[i];
+        }
+        _decelIndex = UINT32_MAX;
+        setRates(rates, STEP_RATE_ONE);
+    }
+
+    // Start the loaded move. Returns the delay to the first tick in us, 0 if there is nothing to do.
+    uint32_t start()
+    {
+        _now = 0;
+        _done = 0;
+        _owed = 0;
+        _decelIndex = UINT32_MAX;
+        _finishing = false;
+        for (uint8_t i = 0; i < STEP_CHANNELS; i++)
+            _channels[i].done = 0;
+
+        _running = _profile.steps > 0;
+        _interval = _running ? intervalFor(0) : 0;
+        return _interval;
+    }
+
+    // Called from the timer interrupt at the time requested by the previous call.
+    // Returns the mask of channels to pulse, nextDelay receives the delay to the
+    // next tick in us, or 0 when the move is complete.
+    STEP_ISR_ATTR uint8_t tick(uint32_t *nextDelay)
+    {
+        _now += _interval;
+        uint8_t mask = 0;
+
+        if (_done < _profile.steps)
+        {
+            for (uint8_t i = 0; i < STEP_CHANNELS; i++)
+            {
+                Channel &c = _channels[i];
+                c.acc += c.rate;
+                if (c.acc >= _denominator)
+                {
+                    c.acc -= _denominator;
+                    c.done++;
+                    mask |= 1 << i;
+                }
+                _owed += c.baseRate - c.rate;
+            }
+            // Lengthen the move until the wheels, at their loaded rates, have made up the
+            // steps the trim skipped
+            if (_profile.steps == STEP_CONTINUOUS)
+                _owed = 0;
+            while (_owed >= _baseTotal)
+            {
+                _owed -= _baseTotal;
+                _profile.steps++;
+            }
+            _done++;
+
+            // Once the deceleration has begun it only goes down the ramp: steps the trim
+            // adds from then on run at the speed reached instead of moving the ramp back
+            uint32_t fromEnd = _profile.steps - 1 - _done;
+            if (_done < _profile.steps && fromEnd < _done && fromEnd < _profile.rampSteps && fromEnd < _decelIndex)
+                _decelIndex = fromEnd;
+        }
+
+        if (_done < _profile.steps)
+        {
+            _interval = intervalFor(_done);
+        }
+        else if (!_finishing)
+        {
+            // One more tick to end the final pulse
+            _finishing = true;
+            _interval = STEP_PULSE_END_US;
+        }
+        else
+        {
+            _running = false;
+            _interval = 0;
+        }
+        *nextDelay = _interval;
+        return mask;
+    }
+
+    // Bring the next tick forward when it was scheduled with a longer interval than the
+    // continuous profile now runs at, so a speed increase does not wait out a slow step.
+    // Returns how many us earlier the tick is due, 0 when it stays.
+    uint32_t hastenNextTick()
+    {
+        if (!_running || _finishing || _done >= _profile.steps || _profile.cruiseInterval >= _interval)
+            return 0;
+        uint32_t earlier = _interval - _profile.cruiseInterval;
+        _interval = _profile.cruiseInterval;
+        return earlier;
+    }
+
+    // Slow a wheel to trim / STEP_RATE_ONE of its loaded rate, for steering corrections.
+    // The move is lengthened so the wheels together still drive their loaded steps: the
+    // trimmed wheel ends short by half the steps it skipped and the other long by as much,
+    // as if one had been slowed and the other sped up. The heading change is kept.
+    void setTrim(uint8_t channel, uint32_t trim)
+    {
+        Channel &c = _channels[channel];
+        c.rate = (uint32_t)((uint64_t)c.baseRate * trim / STEP_RATE_ONE);
+    }
+
+    // End the move after the steps already emitted
+    void stop()
+    {
+        _profile.steps = _done;
+    }
+
+    bool isRunning() const { return _running; }
+
+    uint32_t profileStepsDone() const { return _done; }
+    // Fraction of the profile completed, 0 to 1
+    float progress() const { return _profile.steps > 0 ? (float)_done / _profile.steps : 1; }
+    uint32_t stepsDone(uint8_t channel) const { return _channels[channel].done; }
+    int8_t direction(uint8_t channel) const { return _channels[channel].direction; }
+
+    // Current step interval of the profile and the share of it a wheel gets
+    uint32_t currentInterval() const { return _interval; }
+    float rate(uint8_t channel) const { return (float)_channels[channel].rate / _denominator; }
+    uint32_t now() const { return _now; }
+};
+
+#endif
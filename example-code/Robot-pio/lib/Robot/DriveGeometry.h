@@ -0,0 +1,44 @@
+#ifndef DRIVE_GEOMETRY_H
+#define DRIVE_GEOMETRY_H
+
+#include <math.h>
+#include "MotionLimits.h"
+
+// Wheel circumference in mm
+#define WHEEL_CIRCUMFERENCE 200.0
+
+// Stepper Configuration
+#define STEPS_PER_REVOLUTION 200
+#define MICRO_STEPS 16 // Using 1/16 microstepping
+
+#define STEPS_PER_MM (STEPS_PER_REVOLUTION * MICRO_STEPS / WHEEL_CIRCUMFERENCE)
+
+// Steps of each wheel to turn on the spot by angle degrees
+inline long calculateTurnSteps(double angle)
+{
+    double distance_per_wheel = (angle / 360.0) * (M_PI * WHEEL_DISTANCE);
+    return lround(distance_per_wheel * STEPS_PER_MM);
+}
+
+// Signed wheel steps of a forward arc, the inner wheel is on the side of the turn.
+// The right motor is inverted, and a radius of 0 gives the same steps as a turn on the spot.
+inline void calculateArcSteps(double radius, double angle, long *leftSteps, long *rightSteps)
+{
+    double radians = fabs(angle) * M_PI / 180.0;
+    double halfWidth = (angle > 0 ? 1 : -1) * WHEEL_DISTANCE / 2;
+    *leftSteps = lround((radius - halfWidth) * radians * STEPS_PER_MM);
+    *rightSteps = -lround((radius + halfWidth) * radians * STEPS_PER_MM);
+}
+
+// Speed of the outer wheel (steps/s) that keeps the sideways acceleration on an arc
+// within lateralAccel (mm/s^2), never faster than maxSpeed
+inline float arcOuterSpeed(double radius, double lateralAccel, float maxSpeed)
+{
+    if (radius <= 0)
+        return maxSpeed;
+    double centerSpeed = sqrt(lateralAccel * radius);
+    double outerSpeed = centerSpeed * (radius + WHEEL_DISTANCE / 2) / radius * STEPS_PER_MM;
+    return outerSpeed < maxSpeed ? outerSpeed : maxSpeed;
+}
+
+#endif
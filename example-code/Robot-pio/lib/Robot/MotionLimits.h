@@ -0,0 +1,11 @@
+#ifndef MOTION_LIMITS_H
+#define MOTION_LIMITS_H
+
+// Distance between the two driving wheels, measured on the robot and set in src/config.cpp
+extern const double WHEEL_DISTANCE; // mm
+
+// Safety Limits, checked when a sequence is built and again before each movement
+#define MAX_DISTANCE 2500 // mm
+#define MAX_ANGLE 360.0   // degrees
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef MOTION_TIMING_H
+#define MOTION_TIMING_H
+
+#include <math.h>
+#include <stdlib.h>
+#include "SCurve.h"
+#include "DriveGeometry.h"
+
+// Movement Parameters
+#define MOVE_SPEED (400 * MICRO_STEPS)
+#define MOVE_ACCEL (MOVE_SPEED * 1.5)
+// Max jerk (steps/s^3) of the S-curve profile for moves, 0 for a trapezoid profile.
+// At the same speed and acceleration an S-curve is slower, it pays off once they are raised.
+#define MOVE_JERK 0
+// Slowest cruise speed a move is slowed down to when it is given a duration
+#define MOVE_MIN_SPEED (20 * MICRO_STEPS)
+// A move given a duration cruises at one of these levels, spaced evenly in ratio from
+// MOVE_MIN_SPEED to MOVE_SPEED, so moves of similar speed share one ramp table
+#define TIMED_SPEED_LEVELS 32
+
+// turn speed and acceleration, do not change these values
+#define TURN_SPEED (200 * MICRO_STEPS)
+#define TURN_ACCEL (TURN_SPEED * 2.0)
+
+// minimum stop time after turning, do not change this value
+#define MIN_STOP_TIME 50 // ms
+
+// Largest sideways acceleration on an arc, limits the speed on tight arcs
+#define ARC_LATERAL_ACCEL 1000 // mm/s^2
+
+// Speed of the outer wheel (steps/s) that keeps the sideways acceleration within ARC_LATERAL_ACCEL
+inline float arcSpeed(double radius)
+{
+    return arcOuterSpeed(radius, ARC_LATERAL_ACCEL, MOVE_SPEED);
+}
+
+// Cruise speed (steps/s) that fills duration ms, stop after the move included.
+// Never faster than maxSpeed, nor slower than MOVE_MIN_SPEED.
+// Rounded up to a speed level: the move ends up to a level early and the wait for the next command takes the rest.
+inline float speedForDuration(long steps, float maxSpeed, unsigned long duration)
+{
+    if (duration <= MIN_STOP_TIME)
+        return maxSpeed;
+    float speed = profileSpeedForTime(labs(steps), (duration - MIN_STOP_TIME) / 1000.0f, maxSpeed, MOVE_ACCEL, MOVE_JERK);
+    float slowest = MOVE_MIN_SPEED < maxSpeed ? MOVE_MIN_SPEED : maxSpeed;
+    if (speed < slowest)
+        speed = slowest;
+
+    float ratio = powf((float)MOVE_SPEED / MOVE_MIN_SPEED, 1.0f / (TIMED_SPEED_LEVELS - 1));
+    float level = MOVE_SPEED / powf(ratio, floorf(logf(MOVE_SPEED / speed) / logf(ratio)));
+    return level < maxSpeed ? level : maxSpeed;
+}
+
+// Time a move takes from rest to rest, including the stop after it, ms.
+// With a duration, the time it takes when slowed down to fill it.
+inline unsigned long estimateMoveTime(long distance, unsigned long duration = 0)
+{
+    long steps = labs(distance) * MICRO_STEPS;
+    float speed = speedForDuration(steps, MOVE_SPEED, duration);
+    float seconds = profileMoveTime(steps, speed, MOVE_ACCEL, MOVE_JERK);
+    return lroundf(seconds * 1000) + MIN_STOP_TIME;
+}
+
+inline unsigned long estimateArcTime(double radius, double angle, unsigned long duration = 0)
+{
+    long leftSteps, rightSteps;
+    calculateArcSteps(radius, angle, &leftSteps, &rightSteps);
+    long steps = labs(leftSteps) > labs(rightSteps) ? labs(leftSteps) : labs(rightSteps);
+    float speed = speedForDuration(steps, arcSpeed(radius), duration);
+    float seconds = profileMoveTime(steps, speed, MOVE_ACCEL, MOVE_JERK);
+    return lroundf(seconds * 1000) + MIN_STOP_TIME;
+}
+
+// Step based estimate, IMU turns take a little longer
+inline unsigned long estimateTurnTime(double angle)
+{
+    float seconds = profileMoveTime(labs(calculateTurnSteps(angle)), TURN_SPEED, TURN_ACCEL, 0);
+    return lroundf(seconds * 1000) + MIN_STOP_TIME;
+}
+
+#endif
@@ -2,10 +2,20 @@
 #define ROBOT_H
 
 #include <Arduino.h>
-#include <AccelStepper.h>
-#include <PID_v1.h>
+#include <StepEngine.h>
+#include <RampArena.h>
+#include <MotionService.h>
+#include <Pid.h>
+#include <ControlLoop.h>
+#include <TurnController.h>
+#include <HeadingHold.h>
+#include <MotionLimits.h>
+#include <DriveGeometry.h>
+#include <MotionTiming.h>
 #include "Logger.h"
 #include "IMU.h"
+#include "SeqLock.h"
+#include <atomic>
 #include "config.h"
 
 // Hardware Configuration
@@ -20,95 +30,96 @@
 #define LASER1 16
 #define LASER2 17
 
-// Wheel circumference in mm
-#define WHEEL_CIRCUMFERENCE 200.0
-
-// Stepper Configuration
-#define STEPS_PER_REVOLUTION 200
-#define MICRO_STEPS 16 // Using 1/16 microstepping
-
-// Movement Parameters
-#define MOVE_SPEED (400 * MICRO_STEPS)
-#define MOVE_ACCEL (MOVE_SPEED * 1.5)
-
-// turn speed and acceleration, do not change these values
-#define TURN_SPEED (200 * MICRO_STEPS)
-#define TURN_ACCEL (TURN_SPEED * 2.0)
-
-// minimum stop time after turning, do not change this value
-#define MIN_STOP_TIME 50 // ms
-
-// PID Parameters for turning
-#define TURN_PID_MIN_SPEED (1 * MICRO_STEPS)
-#define TURN_PID_SAMPLE_TIME 10 // ms
+// Movement parameters and time estimates are in MotionTiming.h
+
+// Predictive turn controller
+#define TURN_MIN_SPEED (1 * MICRO_STEPS)
+// 1 integrates the gyro rate at every read and corrects it with the angle register,
+// the turn sees the angle about 7 ms late instead of 22 ms
+#define IMU_GYRO_FUSION 0
+#if IMU_GYRO_FUSION
+#define TURN_IMU_LATENCY 0.005 // s, age of the IMU reading, raise if turns overshoot
+#else
+#define TURN_IMU_LATENCY 0.02 // s, age of the IMU reading, raise if turns overshoot
+#endif
+#define TURN_ANGLE_THRESHOLD 0.04 // degrees
+#define TURN_CONTROL_PERIOD 2     // ms
+// Largest correction of the turn speed by the tracking PID (TURN_PID_KP/KI/KD in config.cpp)
+#define TURN_PID_MAX_CORRECTION (TURN_SPEED * 0.25)
+
+// Heading hold for straight moves, trims the wheel speeds from the IMU yaw
+#define HEADING_HOLD_KP 0.05      // trim per degree
+#define HEADING_HOLD_KI 0.1       // trim per degree second
+#define HEADING_HOLD_MAX_TRIM 0.1 // largest fraction a wheel is slowed down
+#define HEADING_HOLD_PERIOD 10    // ms, a multiple of MOVEMENT_POLL_PERIOD
+// Set to -1 if heading hold steers away from the starting heading
+#define HEADING_HOLD_YAW_SIGN 1
+
+// Period of the loop waiting for a movement to end
+#define MOVEMENT_POLL_PERIOD 1 // ms
 
 // Safety Limits
 #define MOVEMENT_TIMEOUT 8000 // ms
-#define MAX_DISTANCE 2500     // mm
-#define MAX_ANGLE 360.0       // degrees
 
 // IMU Task Configuration
 #define IMU_TASK_CORE 0
 #define IMU_TASK_PRIORITY 0
 #define IMU_TASK_STACK_SIZE 10000
+#define IMU_RESET_TIMEOUT 50 // ms
+#define IMU_RESET_RETRY_DELAY 5 // ms, between failed resets, so a missing IMU does not hog the core
+#define IMU_STALE_TIME 50000 // us, an older reading is not used for heading hold
+#define IMU_MEASURE_SAMPLE_RATE 0 // 1 logs the IMU read rate at start
 
-class Robot
+class Robot : public MotionExecutor
 {
 private:
     // Hardware Components
-    AccelStepper _leftStepper;
-    AccelStepper _rightStepper;
+    StepEngine _steppers;
     IMU _imu;
+    MotionService _motion;
 
     // State Variables
     bool _useIMU = true;
-    volatile bool resetAngle = false;
-    volatile bool imuOn = false;
-    static volatile double currentAngle;
+    // Set by the control side, cleared by the IMU task once the reset reading is published,
+    // or by the control side when it gives up waiting
+    std::atomic<bool> resetAngle{false};
+    std::atomic<bool> imuOn{false};
+    std::atomic<bool> headingOn{false};
+    // Written by the IMU task only, read by the control loops without a lock
+    SeqLock<ImuSample> imuSample;
     static TaskHandle_t imuTaskHandle;
-    static SemaphoreHandle_t imuMutex;
 
     // IMU Task Management
     static void imuTask(void *parameter);
     void startIMUTask();
+    bool waitForIMUReset();
 
     // Movement Calculations
-    long calculateTurnSteps(double angle);
     bool checkMovementLimits(long distance, double angle);
-    void configureSteppers(long speed, long acceleration);
+    void configureSteppers(long speed, long acceleration, long jerk = 0);
 
     // Movement Implementation Details
-    void executeStepperMovement(long leftSteps, long rightSteps);
+    bool executeStepperMovement(long leftSteps, long rightSteps, const StepProfile *profile = nullptr,
+                                unsigned long timeout = MOVEMENT_TIMEOUT, bool holdHeading = false,
+                                double headingChange = 0);
+    void startHeadingHold();
+    void updateHeadingHold(HeadingHold &hold, bool backward, double headingChange);
+    void logLoopTiming(const char *name, const ControlLoop &loop);
     void executeIMUGuidedTurn(double targetAngle, int direction);
     void executeStepBasedTurn(double angle);
 
 public:
     // Constructor & Destructor
     Robot(bool useIMU = true)
-        : _leftStepper(AccelStepper::DRIVER, LEFT_STEPPER_STEP_PIN, LEFT_STEPPER_DIR_PIN),
-          _rightStepper(AccelStepper::DRIVER, RIGHT_STEPPER_STEP_PIN, RIGHT_STEPPER_DIR_PIN),
-          _useIMU(useIMU)
+        : _useIMU(useIMU)
     {
+        _steppers.begin(LEFT_STEPPER_STEP_PIN, LEFT_STEPPER_DIR_PIN,
+                        RIGHT_STEPPER_STEP_PIN, RIGHT_STEPPER_DIR_PIN);
         pinMode(LEFT_STEPPER_EN_PIN, OUTPUT);
         pinMode(RIGHT_STEPPER_EN_PIN, OUTPUT);
         pinMode(LASER1, OUTPUT);
         pinMode(LASER2, OUTPUT);
         turnOffSteppers();
-        currentAngle = 0.0;
-
-        // Create mutex for IMU data access
-        if (imuMutex == NULL)
-        {
-            imuMutex = xSemaphoreCreateMutex();
-        }
-    }
-
-    ~Robot()
-    {
-        if (imuMutex != NULL)
-        {
-            vSemaphoreDelete(imuMutex);
-        }
     }
 
     // Basic Control
@@ -118,13 +129,46 @@ public:
     void startIMU();
 
     // Movement Commands
-    void move(long distance);
-    void turn(double angle);
+    // profile: step ramp precomputed with planMove/planTurn, built at run time when null
+    // duration: time the move should take including the stop after it, ms, 0 for full speed.
+    // A move given more time than it needs cruises slower instead of waiting at the end.
+    // The movements return false when refused by a limit, timed out, or an IMU turn ran without
+    // the IMU: their time then says nothing about the command.
+    bool move(long distance, const StepProfile *profile = nullptr, unsigned long duration = 0);
+    // Run consecutive same-direction moves as one motion, without stopping in between
+    bool moveBlended(const long *distances, size_t count, const StepProfile *profile = nullptr,
+                     unsigned long duration = 0);
+    bool turn(double angle, const StepProfile *profile = nullptr);
+    // Drive forward along an arc of radius mm (middle of the robot), positive angle curves right
+    bool arc(double radius, double angle, const StepProfile *profile = nullptr, unsigned long duration = 0);
+    // Turn around one wheel
+    bool pivot(double angle, const StepProfile *profile = nullptr, unsigned long duration = 0);
     void stop(unsigned long duration);
 
+    // Non-blocking Movement Commands, queued to the motion task.
+    // Do not mix with the blocking commands while motion is queued.
+    MotionHandle moveAsync(long distance, const StepProfile *profile = nullptr, unsigned long duration = 0);
+    MotionHandle moveBlendedAsync(const long *distances, size_t count, const StepProfile *profile = nullptr,
+                                  unsigned long duration = 0);
+    MotionHandle turnAsync(double angle, const StepProfile *profile = nullptr);
+    MotionHandle arcAsync(double radius, double angle, const StepProfile *profile = nullptr,
+                          unsigned long duration = 0);
+    MotionHandle pivotAsync(double angle, const StepProfile *profile = nullptr, unsigned long duration = 0);
+    MotionHandle stopAsync(unsigned long duration);
+    bool executeMotion(const MotionCommand &command) override;
+    uint32_t firstStepTime() override { return _steppers.firstStepTime(); }
+    // Timing of the next finished non-blocking command, false when there is none
+    bool popMotionCompletion(MotionCompletion *completion) { return _motion.popCompletion(completion); }
+
+    // Precompute the step ramp of a command into arena, returns false if it does not fit
+    bool planMove(long distance, RampArena &arena, StepProfile *profile, unsigned long duration = 0);
+    // IMU turns need no ramp, profile is left without one
+    bool planTurn(double angle, RampArena &arena, StepProfile *profile);
+    bool planArc(double radius, double angle, RampArena &arena, StepProfile *profile, unsigned long duration = 0);
+
     // IMU-based Movement
-    void turnWithIMU(double angle = 90.0);
-    void turnWithoutIMU(double angle = 90.0);
+    bool turnWithIMU(double angle = 90.0, const StepProfile *profile = nullptr);
+    bool turnWithoutIMU(double angle = 90.0, const StepProfile *profile = nullptr);
 
     // Laser Functions
     void startLasers();
@@ -132,16 +176,9 @@ public:
 };
 
 // Member variables
-volatile double Robot::currentAngle = 0.0;
 TaskHandle_t Robot::imuTaskHandle = NULL;
-SemaphoreHandle_t Robot::imuMutex = NULL;
 
 // Implementation of private helper methods
-inline long Robot::calculateTurnSteps(double angle)
-{
-    double distance_per_wheel = (angle / 360.0) * (PI * WHEEL_DISTANCE);
-    return round(distance_per_wheel * (STEPS_PER_REVOLUTION * MICRO_STEPS / WHEEL_CIRCUMFERENCE));
-}
 
 inline bool Robot::checkMovementLimits(long distance, double angle)
 {
@@ -158,12 +195,9 @@ inline bool Robot::checkMovementLimits(long distance, double angle)
     return true;
 }
 
-inline void Robot::configureSteppers(long speed, long acceleration)
+inline void Robot::configureSteppers(long speed, long acceleration, long jerk)
 {
-    _leftStepper.setMaxSpeed(speed);
-    _rightStepper.setMaxSpeed(speed);
-    _leftStepper.setAcceleration(acceleration);
-    _rightStepper.setAcceleration(acceleration);
+    _steppers.configure(speed, acceleration, jerk);
 }
 
 // Implementation of public interface
@@ -179,8 +213,7 @@ void Robot::turnOffSteppers()
     logger.info("Turning off steppers");
     digitalWrite(LEFT_STEPPER_EN_PIN, HIGH);
     digitalWrite(RIGHT_STEPPER_EN_PIN, HIGH);
-    _leftStepper.setCurrentPosition(0);
-    _rightStepper.setCurrentPosition(0);
+    _steppers.stop();
 }
 
 void Robot::setUseIMU(bool useIMU)
@@ -195,8 +228,11 @@ void Robot::startIMU()
 
     logger.info("Starting IMU");
     _imu.Start();
+    _imu.SetFusion(IMU_GYRO_FUSION);
+#if IMU_MEASURE_SAMPLE_RATE
+    _imu.MeasureSampleRate();
+#endif
     _imu.ResetAngle();
-    currentAngle = 0.0;
     imuOn = false;
     startIMUTask();
 }
@@ -224,247 +260,398 @@ void Robot::startIMUTask()
 void Robot::imuTask(void *parameter)
 {
     Robot *robot = (Robot *)parameter;
+    ImuSample sample = {};
+    bool resetFailed = false;
 
     while (true)
     {
-        xSemaphoreTake(robot->imuMutex, portMAX_DELAY);
         if (robot->resetAngle)
         {
-            currentAngle = 0.0;
-            robot->_imu.ResetAngle();
+            // Retried until the yaw reads 0, the control side gives up after IMU_RESET_TIMEOUT
+            if (!robot->_imu.ResetAngle())
+            {
+                if (!resetFailed)
+                    logger.warn("IMU angle reset failed, retrying");
+                resetFailed = true;
+                vTaskDelay(pdMS_TO_TICKS(IMU_RESET_RETRY_DELAY));
+                continue;
+            }
+            resetFailed = false;
+            sample.angle = 0;
+            sample.yaw = 0;
+            sample.rate = 0;
+            sample.micros = micros();
+            sample.sequence++;
+            robot->imuSample.write(sample);
+            // After the write, a reader that sees the flag cleared reads the reset sample or a newer one
             robot->resetAngle = false;
         }
+
         if (robot->imuOn)
         {
-            currentAngle = robot->_imu.GetAngle();
+            sample.angle = robot->_imu.GetAngle();
+            sample.rate = robot->_imu.GetRate(false);
+        }
+        else if (robot->headingOn)
+        {
+            sample.yaw = robot->_imu.GetYaw();
         }
         else
         {
             vTaskDelay(pdMS_TO_TICKS(1));
+            continue;
+        }
+        sample.micros = robot->_imu.GetSampleTime();
+        sample.sequence++;
+        robot->imuSample.write(sample);
+    }
+}
+
+// Wait until the IMU task has reset the angle, the readings before it are of the last move
+bool Robot::waitForIMUReset()
+{
+    unsigned long startTime = millis();
+    while (resetAngle)
+    {
+        if (millis() - startTime > IMU_RESET_TIMEOUT)
+        {
+            resetAngle = false;
+            logger.error("IMU reset timeout");
+            return false;
         }
-        xSemaphoreGive(robot->imuMutex);
+        delay(1);
     }
+    return true;
 }
 
 // Movement Implementation Methods
-void Robot::executeStepperMovement(long leftSteps, long rightSteps)
+bool Robot::executeStepperMovement(long leftSteps, long rightSteps, const StepProfile *profile,
+                                   unsigned long timeout, bool holdHeading, double headingChange)
 {
-    _leftStepper.setCurrentPosition(0);
-    _rightStepper.setCurrentPosition(0);
+    HeadingHold hold(HEADING_HOLD_KP, HEADING_HOLD_KI, HEADING_HOLD_MAX_TRIM, HEADING_HOLD_PERIOD / 1000.0f);
+    if (holdHeading)
+        startHeadingHold();
 
-    _leftStepper.moveTo(leftSteps);
-    _rightStepper.moveTo(rightSteps);
+    // Steps are emitted by the timer interrupt, this task only waits
+    if (profile != nullptr)
+        _steppers.start(leftSteps, rightSteps, *profile);
+    else
+        _steppers.start(leftSteps, rightSteps);
 
+    ControlLoop loop(MOVEMENT_POLL_PERIOD * 1000);
+    loop.start();
     unsigned long startTime = millis();
-    while (_leftStepper.currentPosition() != _leftStepper.targetPosition())
+    bool finished = true;
+    while (_steppers.isRunning())
     {
-        if (millis() - startTime > MOVEMENT_TIMEOUT)
+        if (millis() - startTime > timeout)
         {
             logger.error("Movement timeout");
+            _steppers.stop();
+            finished = false;
             break;
         }
-        _leftStepper.run();
-        _rightStepper.run();
+        if (holdHeading && loop.cycles() % (HEADING_HOLD_PERIOD / MOVEMENT_POLL_PERIOD) == 0)
+            updateHeadingHold(hold, leftSteps - rightSteps < 0, headingChange); // Right motor is inverted
+        loop.wait();
     }
+
+    if (holdHeading)
+    {
+        headingOn = false;
+        logger.info("Heading hold: final yaw %D of %D, max error %D degrees", imuSample.read().yaw, headingChange, (double)hold.maxError());
+        logLoopTiming("Heading hold", loop);
+    }
+    return finished;
 }
 
-void Robot::move(long distance)
+void Robot::startHeadingHold()
 {
-    if (!checkMovementLimits(distance, 0))
+    if (!_useIMU)
         return;
+    resetAngle = true;
+    headingOn = true;
+    waitForIMUReset();
+}
+
+// On an arc the heading to hold turns by headingChange over the move, in step with the wheels.
+void Robot::updateHeadingHold(HeadingHold &hold, bool backward, double headingChange)
+{
+    if (!headingOn)
+        return;
+
+    // A stale yaw would steer on where the robot was, hold the trim until the IMU reads again
+    ImuSample sample = imuSample.read();
+    if ((uint32_t)(micros() - sample.micros) > IMU_STALE_TIME)
+        return;
+
+    float leftTrim, rightTrim;
+    hold.update(HEADING_HOLD_YAW_SIGN * sample.yaw, headingChange * _steppers.progress(), backward, &leftTrim, &rightTrim);
+    _steppers.setTrim(leftTrim, rightTrim);
+}
+
+void Robot::logLoopTiming(const char *name, const ControlLoop &loop)
+{
+    logger.info("%s loop: %u cycles, period %u us, actual mean %u us, min %u us, max %u us, overruns %u",
+                name, loop.cycles(), loop.periodUs(), loop.meanInterval(),
+                loop.minInterval(), loop.maxInterval(), loop.overruns());
+}
+
+bool Robot::planMove(long distance, RampArena &arena, StepProfile *profile, unsigned long duration)
+{
+    long steps = abs(distance) * MICRO_STEPS;
+    return arena.plan(steps, speedForDuration(steps, MOVE_SPEED, duration), MOVE_ACCEL, MOVE_JERK, profile);
+}
+
+bool Robot::planTurn(double angle, RampArena &arena, StepProfile *profile)
+{
+    // An IMU turn sets its speed on every control cycle and has no ramp,
+    // the rare fallback to a step based turn builds one at run time
+    if (_useIMU)
+        return true;
+    // Turns use a trapezoid, whose ramp does not depend on the angle
+    return arena.plan(calculateTurnSteps(abs(angle)), TURN_SPEED, TURN_ACCEL, 0, profile);
+}
+
+bool Robot::planArc(double radius, double angle, RampArena &arena, StepProfile *profile, unsigned long duration)
+{
+    long leftSteps, rightSteps;
+    calculateArcSteps(radius, angle, &leftSteps, &rightSteps);
+    long steps = max(labs(leftSteps), labs(rightSteps));
+    return arena.plan(steps, speedForDuration(steps, arcSpeed(radius), duration), MOVE_ACCEL, MOVE_JERK, profile);
+}
+
+bool Robot::move(long distance, const StepProfile *profile, unsigned long duration)
+{
+    if (!checkMovementLimits(distance, 0))
+        return false;
 
     unsigned long startTime = millis();
     long steps = distance * MICRO_STEPS;
     logger.info("Moving %d mm(%l steps)", distance, steps);
 
-    configureSteppers(MOVE_SPEED, MOVE_ACCEL);
-    executeStepperMovement(steps, -steps); // Right motor is inverted
+    if (profile == nullptr)
+        configureSteppers(speedForDuration(steps, MOVE_SPEED, duration), MOVE_ACCEL, MOVE_JERK);
+    bool finished = executeStepperMovement(steps, -steps, profile, MOVEMENT_TIMEOUT + duration, _useIMU); // Right motor is inverted
     delay(MIN_STOP_TIME);
     unsigned long totalTime = millis() - startTime;
-    logger.info("Move time: %u ms", totalTime);
+    if (duration > 0)
+        logger.info("Move time: %u ms, target %u ms", totalTime, duration);
+    else
+        logger.info("Move time: %u ms", totalTime);
+    return finished;
 }
 
-void Robot::turn(double angle)
+bool Robot::moveBlended(const long *distances, size_t count, const StepProfile *profile, unsigned long duration)
 {
+    long distance = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!checkMovementLimits(distances[i], 0))
+            return false;
+        distance += distances[i];
+    }
+
     unsigned long startTime = millis();
+    long steps = distance * MICRO_STEPS;
+    logger.info("Moving %d mm(%l steps) blended from %d moves", distance, steps, count);
+
+    if (profile == nullptr)
+        configureSteppers(speedForDuration(steps, MOVE_SPEED, duration), MOVE_ACCEL, MOVE_JERK);
+    bool finished = executeStepperMovement(steps, -steps, profile, MOVEMENT_TIMEOUT * count + duration, _useIMU); // Right motor is inverted
+    delay(MIN_STOP_TIME);
+    unsigned long totalTime = millis() - startTime;
+    if (duration > 0)
+        logger.info("Move time: %u ms, target %u ms", totalTime, duration);
+    else
+        logger.info("Move time: %u ms", totalTime);
+    return finished;
+}
+
+bool Robot::turn(double angle, const StepProfile *profile)
+{
+    unsigned long startTime = millis();
+    bool finished;
     if (_useIMU)
     {
-        turnWithIMU(angle);
+        finished = turnWithIMU(angle, profile);
     }
     else
     {
-        turnWithoutIMU(angle);
+        finished = turnWithoutIMU(angle, profile);
     }
     unsigned long totalTime = millis() - startTime;
     logger.info("Turn time: %u ms", totalTime);
+    return finished;
 }
 
-void Robot::turnWithIMU(double angle)
+bool Robot::turnWithIMU(double angle, const StepProfile *profile)
 {
     if (!_useIMU)
     {
         logger.warn("IMU is disabled, using non-IMU turn");
-        turnWithoutIMU(angle);
-        return;
+        turnWithoutIMU(angle, profile);
+        return false;
     }
 
     if (!checkMovementLimits(0, angle))
-        return;
+        return false;
 
     logger.info("Turning %D degrees with IMU", angle);
     // reset the angle to 0
-    // xSemaphoreTake(imuMutex, portMAX_DELAY);
     resetAngle = true;
-    currentAngle = 0.0;
     imuOn = true;
-    // xSemaphoreGive(imuMutex);
-    delay(5);
+    if (!waitForIMUReset())
+    {
+        imuOn = false;
+        turnWithoutIMU(angle, profile);
+        return false;
+    }
     // correct the angle for the left and right turns
     double correctedAngle = angle * (angle < 0 ? LEFT_TURN_COMPENSATION : RIGHT_TURN_COMPENSATION);
     logger.info("Corrected angle: %D degrees", correctedAngle);
 
     double targetAngle = abs(correctedAngle);
-    long steps = calculateTurnSteps(targetAngle);
     int direction = (angle > 0) ? -1 : 1;
 
-    // stage 1, move to 92% of target angle
-    double stage1Percent = 0.92;
-    long stage1Steps = steps * stage1Percent;
-    logger.info("Stage 1: Turning to %D degrees(%l steps)", correctedAngle * stage1Percent, stage1Steps);
-
-    configureSteppers(TURN_SPEED, TURN_ACCEL);
-
-    _leftStepper.setCurrentPosition(0);
-    _rightStepper.setCurrentPosition(0);
-
-    _leftStepper.move(steps * direction);
-    _rightStepper.move(steps * direction);
-
-    unsigned long startTime = millis();
-    while (_leftStepper.currentPosition() != stage1Steps * direction)
-    {
-        if (millis() - startTime > MOVEMENT_TIMEOUT)
-        {
-            logger.error("Movement timeout");
-            break;
-        }
-        _leftStepper.run();
-        _rightStepper.run();
-    }
-    double stage1Speed = _leftStepper.speed();
-
-    logger.info("Stage 2: PID control to %D degrees", targetAngle);
-    logger.info("Stage 2 start speed: %D", stage1Speed);
-
-    // Initialize PID variables
-    double pidInput = currentAngle;
-    double pidOutput = abs(stage1Speed);
-    double pidSetpoint = targetAngle;
-
-    // Create and configure PID with adjusted parameters
-    PID pid(&pidInput, &pidOutput, &pidSetpoint,
-            TURN_PID_KP,
-            TURN_PID_KI,
-            TURN_PID_KD,
-            DIRECT);
-    pid.SetMode(AUTOMATIC);
-    pid.SetOutputLimits(TURN_PID_MIN_SPEED, abs(stage1Speed));
-    pid.SetSampleTime(TURN_PID_SAMPLE_TIME);
-
-    // Adjusted thresholds
-    const double ANGLE_THRESHOLD = 0.04;
-    double lastAngle = pidInput;
-
+    double stepsPerDegree = (PI * WHEEL_DISTANCE / 360.0) * (STEPS_PER_REVOLUTION * MICRO_STEPS / WHEEL_CIRCUMFERENCE);
+    TurnController controller(TURN_SPEED / stepsPerDegree, TURN_ACCEL / stepsPerDegree,
+                              TURN_MIN_SPEED / stepsPerDegree, TURN_IMU_LATENCY, TURN_ANGLE_THRESHOLD);
+    ControlLoop loop(TURN_CONTROL_PERIOD * 1000);
+    // Corrects the speed when the robot falls behind or runs ahead of the commanded rate,
+    // e.g. when the wheels slip. Gains are steps/s per degree of tracking error.
+    Pid tracking(TURN_PID_KP, TURN_PID_KI, TURN_PID_KD,
+                 -TURN_PID_MAX_CORRECTION, TURN_PID_MAX_CORRECTION, loop.period());
+    logger.info("Predictive turn to %D degrees", targetAngle);
+
+    ImuSample sample = imuSample.read();
+    double angleNow = sample.angle;
+    uint32_t lastSequence = sample.sequence;
+    double rate = 0;
+    double reference = 0; // angle the commanded rates add up to
     unsigned long count = 0;
-    unsigned long lastLog = millis();
     unsigned long aCount = 0;
+    unsigned long startTime = millis();
+    unsigned long lastLog = startTime;
+    bool finished = true;
+    loop.start();
     while (true)
     {
         if (millis() - startTime > MOVEMENT_TIMEOUT)
         {
-            logger.error("Turn timeout in PID control");
-            break;
-        }
-
-        pidInput = currentAngle;
-        // Get current angle and check if we're within threshold
-        double angleError = targetAngle - pidInput;
-        if (angleError <= ANGLE_THRESHOLD)
-        {
+            logger.error("Turn timeout");
+            finished = false;
             break;
         }
 
-        if (lastAngle != pidInput)
+        sample = imuSample.read();
+        angleNow = sample.angle;
+        rate = abs(sample.rate);
+        if (sample.sequence != lastSequence)
         {
-            lastAngle = pidInput;
+            lastSequence = sample.sequence;
             aCount++;
         }
 
-        // Update PID input and compute new output
-        pid.Compute();
-
-        // Scale down speed as we approach target
-        // Start scaling when within 2.2 degrees
-        double speedScale = _min(1.0, angleError / 2.2);
-        double adjustedSpeed = _max(TURN_PID_MIN_SPEED, pidOutput * speedScale);
+        float command = controller.update(targetAngle, angleNow, rate, loop.period());
+        if (command == 0)
+            break;
 
-        // Apply speeds
-        _leftStepper.setSpeed(direction * adjustedSpeed);
-        _rightStepper.setSpeed(direction * adjustedSpeed);
+        reference = min(reference + command * loop.period(), targetAngle);
+        double speed = command * stepsPerDegree + tracking.update(reference, controller.predictedAngle());
+        if (speed < TURN_MIN_SPEED)
+            speed = TURN_MIN_SPEED;
 
-        // Run motors
-        _leftStepper.runSpeed();
-        _rightStepper.runSpeed();
+        // The timer keeps stepping at the last speed set
+        _steppers.setSpeed(direction * speed, direction * speed);
 
         if (millis() - lastLog > 50)
         {
-            logger.info("Angle: %D, Speed: %D, error: %D",
-                        pidInput, adjustedSpeed * direction, angleError);
+            logger.info("Angle: %D, predicted: %D, reference: %D, rate: %D, speed: %D",
+                        angleNow, controller.predictedAngle(), reference, rate, speed * direction);
             lastLog = millis();
         }
 
         count++;
+        loop.wait();
     }
 
     // Immediately stop motors
-    _leftStepper.setSpeed(0);
-    _rightStepper.setSpeed(0);
-    _leftStepper.runSpeed();
-    _rightStepper.runSpeed();
+    _steppers.stop();
 
     unsigned long imuCount = _imu.GetCount();
+    logLoopTiming("Turn", loop);
 
     delay(MIN_STOP_TIME);
-    double finalAngle = currentAngle;
+    double finalAngle = imuSample.read().angle;
     imuOn = false;
     // error too big
     if (abs(finalAngle - targetAngle) > 0.03)
     {
         logger.lcdSet(COLOR_RED);
         logger.lcdPrintf("Angle:\n%.2f", finalAngle);
-        logger.error("Final Angle: %D, steps: %l, count: %u, angle change count: %u, imu count: %u",
-                     finalAngle, _leftStepper.currentPosition(), count, aCount, imuCount);
+        logger.error("Final Angle: %D, steps: %l, count: %u, new samples: %u, imu count: %u, imu errors: %u, outliers: %u",
+                     finalAngle, _steppers.position(STEP_LEFT), count, aCount, imuCount, _imu.GetErrorCount(), _imu.GetOutlierCount());
     }
     else
     {
         logger.lcdSet(COLOR_CYAN);
         logger.lcdPrintf("Angle:\n%.2f", finalAngle);
-        logger.info("Final Angle: %D, steps: %l, count: %u, angle change count: %u, imu count: %u",
-                    finalAngle, _leftStepper.currentPosition(), count, aCount, imuCount);
+        logger.info("Final Angle: %D, steps: %l, count: %u, new samples: %u, imu count: %u, imu errors: %u, outliers: %u",
+                    finalAngle, _steppers.position(STEP_LEFT), count, aCount, imuCount, _imu.GetErrorCount(), _imu.GetOutlierCount());
     }
+    return finished;
 }
 
-void Robot::turnWithoutIMU(double angle)
+bool Robot::turnWithoutIMU(double angle, const StepProfile *profile)
 {
     if (!checkMovementLimits(0, angle))
-        return;
+        return false;
 
     long steps = calculateTurnSteps(angle);
     logger.info("Turning %D degrees(%ld steps) without IMU", angle, steps);
 
-    configureSteppers(TURN_SPEED, TURN_ACCEL);
-    executeStepperMovement(-steps, -steps);
+    if (profile == nullptr)
+        configureSteppers(TURN_SPEED, TURN_ACCEL);
+    bool finished = executeStepperMovement(-steps, -steps, profile);
+    delay(MIN_STOP_TIME);
+    return finished;
+}
+
+bool Robot::arc(double radius, double angle, const StepProfile *profile, unsigned long duration)
+{
+    if (radius < 0)
+    {
+        logger.error("Arc radius must not be negative");
+        return false;
+    }
+
+    long leftSteps, rightSteps;
+    calculateArcSteps(radius, angle, &leftSteps, &rightSteps);
+    long outerSteps = max(labs(leftSteps), labs(rightSteps));
+    long outerDistance = lround(outerSteps * WHEEL_CIRCUMFERENCE / (STEPS_PER_REVOLUTION * MICRO_STEPS));
+    if (!checkMovementLimits(outerDistance, angle))
+        return false;
+
+    unsigned long startTime = millis();
+    logger.info("Arc of %D degrees on %D mm radius(%l, %l steps)", angle, radius, leftSteps, rightSteps);
+
+    if (profile == nullptr)
+        configureSteppers(speedForDuration(outerSteps, arcSpeed(radius), duration), MOVE_ACCEL, MOVE_JERK);
+    // Heading hold follows the turning heading, so the IMU corrects wheel slip on the way
+    bool finished = executeStepperMovement(leftSteps, rightSteps, profile, MOVEMENT_TIMEOUT + duration, _useIMU, angle);
     delay(MIN_STOP_TIME);
+    unsigned long totalTime = millis() - startTime;
+    if (duration > 0)
+        logger.info("Arc time: %u ms, target %u ms", totalTime, duration);
+    else
+        logger.info("Arc time: %u ms", totalTime);
+    return finished;
+}
+
+bool Robot::pivot(double angle, const StepProfile *profile, unsigned long duration)
+{
+    return arc(WHEEL_DISTANCE / 2, angle, profile, duration);
 }
 
 void Robot::stop(unsigned long duration)
@@ -473,6 +660,63 @@ void Robot::stop(unsigned long duration)
     delay(duration);
 }
 
+MotionHandle Robot::moveAsync(long distance, const StepProfile *profile, unsigned long duration)
+{
+    _motion.begin(this);
+    return _motion.submit(MOTION_MOVE, distance, profile, nullptr, 0, 0, duration);
+}
+
+MotionHandle Robot::moveBlendedAsync(const long *distances, size_t count, const StepProfile *profile,
+                                     unsigned long duration)
+{
+    _motion.begin(this);
+    return _motion.submit(MOTION_MOVE_BLENDED, 0, profile, distances, count, 0, duration);
+}
+
+MotionHandle Robot::turnAsync(double angle, const StepProfile *profile)
+{
+    _motion.begin(this);
+    return _motion.submit(MOTION_TURN, angle, profile);
+}
+
+MotionHandle Robot::arcAsync(double radius, double angle, const StepProfile *profile, unsigned long duration)
+{
+    _motion.begin(this);
+    return _motion.submit(MOTION_ARC, angle, profile, nullptr, 0, radius, duration);
+}
+
+MotionHandle Robot::pivotAsync(double angle, const StepProfile *profile, unsigned long duration)
+{
+    return arcAsync(WHEEL_DISTANCE / 2, angle, profile, duration);
+}
+
+MotionHandle Robot::stopAsync(unsigned long duration)
+{
+    _motion.begin(this);
+    return _motion.submit(MOTION_STOP, duration);
+}
+
+// Runs on the motion task
+bool Robot::executeMotion(const MotionCommand &command)
+{
+    _steppers.clearFirstStep();
+    switch (command.type)
+    {
+    case MOTION_MOVE:
+        return move(static_cast<long>(command.value), command.profile, command.duration);
+    case MOTION_MOVE_BLENDED:
+        return moveBlended(command.distances, command.count, command.profile, command.duration);
+    case MOTION_TURN:
+        return turn(command.value, command.profile);
+    case MOTION_STOP:
+        stop(static_cast<unsigned long>(command.value));
+        return true;
+    case MOTION_ARC:
+        return arc(command.radius, command.value, command.profile, command.duration);
+    }
+    return false;
+}
+
 void Robot::startLasers()
 {
     digitalWrite(LASER1, HIGH);
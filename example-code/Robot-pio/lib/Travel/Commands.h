@@ -1,69 +1,330 @@
 #ifndef COMMANDS_H
 #define COMMANDS_H
 
-#include <Arduino.h>
-#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+#include <MotionLimits.h>
 
+// Bytes of bytecode a sequence can hold, a move takes 3
+#define COMMAND_CODE_SIZE 768
+
+// Opcodes of the sequence bytecode, each followed by its fixed-point operands:
+//   OP_MOVE  int16 distance, mm
+//   OP_TURN  int16 angle, 0.1 degree
+//   OP_STOP  uint16 duration, ms
+//   OP_ARC   uint16 radius, mm, then int16 angle, 0.1 degree
+//   OP_PIVOT int16 angle, 0.1 degree
+// Operands are little endian. New opcodes go at the end and add their length to operandBytes.
+enum Opcode : uint8_t
+{
+    OP_MOVE = 1,
+    OP_TURN = 2,
+    OP_STOP = 3,
+    OP_ARC = 4,
+    OP_PIVOT = 5
+};
+
+// A decoded instruction
 struct Command
 {
-    String action;
-    double value;
+    Opcode op;
+    double value;  // mm, degrees or ms
+    double radius; // arc radius in mm, 0 for the other commands
 };
 
+constexpr const char *opcodeName(Opcode op)
+{
+    switch (op)
+    {
+    case OP_MOVE:
+        return "move";
+    case OP_TURN:
+        return "turn";
+    case OP_STOP:
+        return "stop";
+    case OP_ARC:
+        return "arc";
+    case OP_PIVOT:
+        return "pivot";
+    }
+    return "unknown";
+}
+
+// Operand bytes after an opcode, -1 for an unknown opcode
+constexpr int operandBytes(uint8_t op)
+{
+    switch (op)
+    {
+    case OP_MOVE:
+    case OP_TURN:
+    case OP_STOP:
+    case OP_PIVOT:
+        return 2;
+    case OP_ARC:
+        return 4;
+    }
+    return -1;
+}
+
+// Called where a sequence breaks a limit. They are not constexpr, so a constexpr
+// sequence that breaks a limit fails to compile, with the name of the limit in the error.
+inline void sequence_distance_exceeds_MAX_DISTANCE() {}
+inline void sequence_angle_exceeds_MAX_ANGLE() {}
+inline void sequence_arc_exceeds_MAX_DISTANCE() {}
+inline void sequence_value_out_of_range() {}
+inline void sequence_exceeds_COMMAND_CODE_SIZE() {}
+
+// Distance the outer wheel drives on an arc, mm, the limit of an arc is that of a move.
+// With a wheelDistance of 0 it is the path of the middle of the robot, which the outer
+// wheel always exceeds.
+constexpr double arcOuterDistance(double radius, double degrees, double wheelDistance)
+{
+    return (degrees < 0 ? -degrees : degrees) * (radius + wheelDistance / 2) * 3.14159265358979 / 180;
+}
+
+// A sequence of commands compiled to bytecode as it is built, in a fixed buffer.
+// Everything is constexpr, so a sequence defined as
+//   constexpr CommandSequence runSequence = CommandSequence().f(1000).l().f();
+// is built by the compiler and kept in flash, and its limits are checked at compile time.
 class CommandSequence
 {
 private:
-    std::vector<Command> commands;
+    uint8_t _code[COMMAND_CODE_SIZE];
+    size_t _length = 0;
+    size_t _count = 0;
+    bool _overflow = false;
+    bool _invalid = false;
 
-public:
-    CommandSequence &move(long distance = 500)
+    static constexpr double magnitude(double value)
     {
-        commands.push_back({"move", static_cast<double>(distance)});
-        return *this;
+        return value < 0 ? -value : value;
     }
 
-    CommandSequence &turn(double degrees = 90)
+    static constexpr int16_t toTenths(double degrees)
     {
-        commands.push_back({"turn", degrees});
-        return *this;
+        return static_cast<int16_t>(degrees < 0 ? degrees * 10 - 0.5 : degrees * 10 + 0.5);
+    }
+
+    constexpr bool checkDistance(double distance)
+    {
+        if (magnitude(distance) <= MAX_DISTANCE)
+            return true;
+        sequence_distance_exceeds_MAX_DISTANCE();
+        _invalid = true;
+        return false;
+    }
+
+    constexpr bool checkAngle(double degrees)
+    {
+        if (magnitude(degrees) <= MAX_ANGLE)
+            return true;
+        sequence_angle_exceeds_MAX_ANGLE();
+        _invalid = true;
+        return false;
+    }
+
+    constexpr bool checkArc(double radius, double degrees)
+    {
+        // WHEEL_DISTANCE is set in config.cpp and only known at run time, so the build checks
+        // the middle of the arc and the outer wheel is checked when the sequence is loaded
+        if (arcOuterDistance(radius, degrees, 0) <= MAX_DISTANCE)
+            return true;
+        sequence_arc_exceeds_MAX_DISTANCE();
+        _invalid = true;
+        return false;
+    }
+
+    constexpr bool checkUnsigned(double value)
+    {
+        if (value >= 0 && value <= 65535)
+            return true;
+        sequence_value_out_of_range();
+        _invalid = true;
+        return false;
     }
 
-    CommandSequence &stop(unsigned long duration)
+    // Append an instruction, two operands of two bytes at most
+    constexpr CommandSequence &emit(Opcode op, uint16_t a, uint16_t b = 0)
     {
-        commands.push_back({"stop", static_cast<double>(duration)});
+        int bytes = operandBytes(op);
+        if (_overflow || _length + 1 + bytes > COMMAND_CODE_SIZE)
+        {
+            sequence_exceeds_COMMAND_CODE_SIZE();
+            _overflow = true;
+            return *this;
+        }
+        _code[_length++] = op;
+        _code[_length++] = a & 0xFF;
+        _code[_length++] = a >> 8;
+        if (bytes == 4)
+        {
+            _code[_length++] = b & 0xFF;
+            _code[_length++] = b >> 8;
+        }
+        _count++;
         return *this;
     }
 
-    CommandSequence &left(double degrees = 90)
+public:
+    constexpr CommandSequence() : _code{} {}
+
+    // Commands that break a limit are left out and mark the sequence invalid
+    constexpr CommandSequence &move(long distance = 500)
+    {
+        if (!checkDistance(distance))
+            return *this;
+        return emit(OP_MOVE, static_cast<uint16_t>(static_cast<int16_t>(distance)));
+    }
+
+    constexpr CommandSequence &turn(double degrees = 90)
+    {
+        if (!checkAngle(degrees))
+            return *this;
+        return emit(OP_TURN, static_cast<uint16_t>(toTenths(degrees)));
+    }
+
+    constexpr CommandSequence &stop(unsigned long duration)
+    {
+        if (!checkUnsigned(duration))
+            return *this;
+        return emit(OP_STOP, static_cast<uint16_t>(duration));
+    }
+
+    // Drive forward along an arc, radius measured to the middle between the wheels.
+    // Positive degrees curve right, negative left, like turn.
+    // The middle of the arc may drive MAX_DISTANCE at most, checked on the stored radius and angle.
+    constexpr CommandSequence &arc(double radius, double degrees = 90)
+    {
+        if (!checkUnsigned(radius + 0.5) || !checkAngle(degrees) ||
+            !checkArc(static_cast<uint16_t>(radius + 0.5), toTenths(degrees) / 10.0))
+            return *this;
+        return emit(OP_ARC, static_cast<uint16_t>(radius + 0.5), static_cast<uint16_t>(toTenths(degrees)));
+    }
+
+    // Turn around one wheel, which stays in place
+    constexpr CommandSequence &pivot(double degrees = 90)
+    {
+        if (!checkAngle(degrees))
+            return *this;
+        return emit(OP_PIVOT, static_cast<uint16_t>(toTenths(degrees)));
+    }
+
+    constexpr CommandSequence &left(double degrees = 90)
     {
         return turn(-degrees);
     }
 
-    CommandSequence &right(double degrees = 90)
+    constexpr CommandSequence &right(double degrees = 90)
     {
         return turn(degrees);
     }
 
-    CommandSequence &forward(long distance = 500)
+    constexpr CommandSequence &forward(long distance = 500)
     {
         return move(distance);
     }
 
-    CommandSequence &backward(long distance = 500)
+    constexpr CommandSequence &backward(long distance = 500)
     {
         return move(-distance);
     }
 
     // Aliases for common commands
-    CommandSequence &l(double degrees = 90) { return left(degrees); }
-    CommandSequence &r(double degrees = 90) { return right(degrees); }
-    CommandSequence &f(long distance = 500) { return forward(distance); }
-    CommandSequence &b(long distance = 500) { return backward(distance); }
+    constexpr CommandSequence &l(double degrees = 90) { return left(degrees); }
+    constexpr CommandSequence &r(double degrees = 90) { return right(degrees); }
+    constexpr CommandSequence &f(long distance = 500) { return forward(distance); }
+    constexpr CommandSequence &b(long distance = 500) { return backward(distance); }
+
+    // Replace the sequence with stored bytecode, e.g. read back from flash.
+    // Code with an unknown opcode or a cut off instruction leaves the sequence empty.
+    constexpr bool assign(const uint8_t *code, size_t length)
+    {
+        *this = CommandSequence();
+        if (length > COMMAND_CODE_SIZE)
+            return false;
+        size_t count = 0;
+        for (size_t pos = 0; pos < length; count++)
+        {
+            int bytes = operandBytes(code[pos]);
+            if (bytes < 0 || pos + 1 + bytes > length)
+                return false;
+            pos += 1 + bytes;
+        }
+        for (size_t i = 0; i < length; i++)
+            _code[i] = code[i];
+        _length = length;
+        _count = count;
+        return true;
+    }
+
+    constexpr const uint8_t *code() const { return _code; }
+    constexpr size_t length() const { return _length; }
+    constexpr size_t size() const { return _count; }
+    constexpr bool empty() const { return _count == 0; }
+    // True when commands were dropped because the code buffer is full
+    constexpr bool overflow() const { return _overflow; }
+    // False when a command broke a limit and was left out
+    constexpr bool valid() const { return !_invalid && !_overflow; }
+};
+
+// Reads the instructions of a sequence one at a time
+class CommandReader
+{
+private:
+    const uint8_t *_code;
+    size_t _length;
+    size_t _pos = 0;
+
+    int16_t readInt16()
+    {
+        uint16_t value = _code[_pos] | (_code[_pos + 1] << 8);
+        _pos += 2;
+        return static_cast<int16_t>(value);
+    }
+
+    uint16_t readUint16()
+    {
+        return static_cast<uint16_t>(readInt16());
+    }
 
-    const std::vector<Command> &getCommands() const
+public:
+    CommandReader(const CommandSequence &sequence) : _code(sequence.code()), _length(sequence.length()) {}
+
+    // Decode the next instruction, false at the end or on an unknown opcode
+    bool next(Command *command)
     {
-        return commands;
+        if (_pos >= _length)
+            return false;
+        uint8_t op = _code[_pos];
+        int bytes = operandBytes(op);
+        if (bytes < 0 || _pos + 1 + bytes > _length)
+            return false;
+        _pos++;
+
+        command->op = static_cast<Opcode>(op);
+        command->radius = 0;
+        switch (command->op)
+        {
+        case OP_MOVE:
+            command->value = readInt16();
+            break;
+        case OP_TURN:
+        case OP_PIVOT:
+            command->value = readInt16() / 10.0;
+            break;
+        case OP_STOP:
+            command->value = readUint16();
+            break;
+        case OP_ARC:
+            command->radius = readUint16();
+            command->value = readInt16() / 10.0;
+            break;
+        }
+        return true;
     }
+
+    // True when the whole code was read
+    bool atEnd() const { return _pos >= _length; }
 };
 
 #endif
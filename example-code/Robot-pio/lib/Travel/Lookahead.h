@@ -0,0 +1,58 @@
+#ifndef LOOKAHEAD_H
+#define LOOKAHEAD_H
+
+#include <Arduino.h>
+#include <vector>
+#include "Commands.h"
+
+// A run of consecutive commands executed as one motion
+struct Segment
+{
+    size_t first;  // index of the first command
+    size_t count;  // commands in the segment
+    long distance; // total distance when the segment is a blended run of moves, mm
+};
+
+// Looks ahead over a command sequence and groups consecutive moves in the same
+// direction, so they run as one profile without stopping at each command boundary.
+// The robot only comes to rest where the motion reverses, turns or stops.
+class LookaheadPlanner
+{
+public:
+    static bool isBlendable(const Command &a, const Command &b)
+    {
+        return a.op == OP_MOVE && b.op == OP_MOVE &&
+               a.value != 0 && (a.value > 0) == (b.value > 0);
+    }
+
+    static std::vector<Segment> plan(const std::vector<Command> &commands, bool blend)
+    {
+        std::vector<Segment> segments;
+        for (size_t i = 0; i < commands.size(); i++)
+        {
+            if (blend && !segments.empty())
+            {
+                Segment &last = segments.back();
+                if (isBlendable(commands[last.first + last.count - 1], commands[i]))
+                {
+                    last.count++;
+                    last.distance += static_cast<long>(commands[i].value);
+                    continue;
+                }
+            }
+            segments.push_back({i, 1, static_cast<long>(commands[i].value)});
+        }
+        return segments;
+    }
+
+    // Highest speed at a junction position mm into a blended run of total mm,
+    // reachable from rest at the start and able to stop by the end
+    static double junctionSpeed(double position, double total, double speed, double accel)
+    {
+        double fromStart = sqrt(2 * accel * position);
+        double toEnd = sqrt(2 * accel * (total - position));
+        return _min(speed, _min(fromStart, toEnd));
+    }
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <math.h>
+#include <vector>
+#include "Commands.h"
+
+// Rewrites a decoded sequence into fewer commands that end at the same pose:
+//   f(500).f(500)  -> f(1000)   adjacent moves in the same direction, up to MAX_DISTANCE
+//   l().l()        -> l(180)    consecutive turns are folded
+//   l(270)         -> r(90)     turns go the shorter way round
+//   l().r(), f(0)  -> nothing   no-ops are dropped
+//   stop(a).stop(b) -> stop(a + b)
+// Moves in opposite directions are kept, the robot may be meant to drive over a point and back.
+class SequenceOptimizer
+{
+public:
+    // Turns below this are dropped, degrees, half the 0.1 degree resolution of the bytecode
+    static constexpr double ANGLE_EPSILON = 0.05;
+
+    // The same turn in (-180, 180], a half turn keeps its direction
+    static double normalizeAngle(double degrees)
+    {
+        double angle = fmod(degrees, 360.0);
+        if (angle > 180)
+            angle -= 360;
+        else if (angle < -180)
+            angle += 360;
+        return angle;
+    }
+
+    static bool isNoOp(const Command &cmd)
+    {
+        switch (cmd.op)
+        {
+        case OP_MOVE:
+        case OP_STOP:
+            return cmd.value == 0;
+        case OP_TURN:
+        case OP_ARC:
+        case OP_PIVOT:
+            return fabs(cmd.value) < ANGLE_EPSILON;
+        }
+        return false;
+    }
+
+    // A sequence whose commands all cancel out, e.g. the eight l() of a turn calibration,
+    // is returned as written rather than as nothing, and *warning says so
+    static std::vector<Command> optimize(const std::vector<Command> &commands, const char **warning = nullptr)
+    {
+        if (warning != nullptr)
+            *warning = nullptr;
+        std::vector<Command> out;
+        out.reserve(commands.size());
+        for (Command cmd : commands)
+        {
+            if (cmd.op == OP_TURN)
+                cmd.value = normalizeAngle(cmd.value);
+            if (isNoOp(cmd))
+                continue;
+
+            if (!out.empty() && merge(&out.back(), cmd))
+            {
+                // Turns that cancel out leave nothing, the commands around them may merge next
+                if (isNoOp(out.back()))
+                    out.pop_back();
+                continue;
+            }
+            out.push_back(cmd);
+        }
+        if (out.empty() && !commands.empty())
+        {
+            if (warning != nullptr)
+                *warning = "all commands cancel out, sequence kept as written";
+            return commands;
+        }
+        return out;
+    }
+
+private:
+    // Fold cmd into last, false when they cannot be merged
+    static bool merge(Command *last, const Command &cmd)
+    {
+        if (last->op != cmd.op)
+            return false;
+
+        switch (cmd.op)
+        {
+        case OP_MOVE:
+            if ((last->value > 0) != (cmd.value > 0) || fabs(last->value + cmd.value) > MAX_DISTANCE)
+                return false;
+            last->value += cmd.value;
+            return true;
+        case OP_TURN:
+            last->value = normalizeAngle(last->value + cmd.value);
+            return true;
+        case OP_STOP:
+            if (last->value + cmd.value > 65535)
+                return false;
+            last->value += cmd.value;
+            return true;
+        default:
+            return false;
+        }
+    }
+};
+
+#endif
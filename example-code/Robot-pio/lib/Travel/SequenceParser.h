@@ -0,0 +1,312 @@
+#ifndef SEQUENCE_PARSER_H
+#define SEQUENCE_PARSER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Commands.h"
+
+// Parses the text form of a sequence one byte at a time, straight into its bytecode:
+//   f500 l r90 b300 s2000 a200,-90 p45
+// f and b move in mm, l and r turn in degrees, s stops in ms, a drives an arc of radius
+// mm and angle degrees, p pivots. A value left out takes the CommandSequence default.
+// Commands are separated by spaces or ';', '#' comments to the end of the line,
+// and the end of a line ends the sequence. Nothing is allocated while parsing.
+class SequenceParser
+{
+public:
+    enum Result
+    {
+        PARSE_MORE,  // the line goes on
+        PARSE_DONE,  // a valid sequence was read, see sequence()
+        PARSE_ERROR, // the line was rejected, see error() and errorColumn()
+        PARSE_EMPTY  // the line had no commands
+    };
+
+private:
+    enum State
+    {
+        IDLE,    // between commands
+        COMMAND, // after a command letter, in its numbers
+        COMMENT, // to the end of the line
+        SKIP     // after an error, to the end of the line
+    };
+
+    // Larger numbers are rejected before they could overflow
+    static const long MAX_MANTISSA = 100000000L;
+
+    CommandSequence _sequence;
+    State _state = IDLE;
+    char _command = 0;
+    uint8_t _operand = 0;    // number being read, 0 or 1
+    uint8_t _operands = 0;   // numbers read for the command
+    long _mantissa = 0;
+    uint8_t _decimals = 0;   // digits after the point
+    bool _fraction = false;  // after the point
+    bool _negative = false;
+    bool _digits = false;    // digits in the number
+    double _values[2] = {0, 0};
+    bool _whole[2] = {true, true};
+    size_t _column = 0;
+    size_t _tokenColumn = 0;
+    const char *_error = nullptr;
+    size_t _errorColumn = 0;
+
+    static bool isSeparator(char c)
+    {
+        return c == ' ' || c == '\t' || c == ';';
+    }
+
+    static bool isCommand(char c)
+    {
+        switch (c)
+        {
+        case 'f':
+        case 'b':
+        case 'l':
+        case 'r':
+        case 's':
+        case 'a':
+        case 'p':
+            return true;
+        }
+        return false;
+    }
+
+    static char lower(char c)
+    {
+        return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+    }
+
+    // Degrees rounded to the 0.1 degree of the bytecode
+    static double rounded(double degrees)
+    {
+        return static_cast<long>(degrees * 10 + (degrees < 0 ? -0.5 : 0.5)) / 10.0;
+    }
+
+    bool fail(const char *error, size_t column)
+    {
+        _error = error;
+        _errorColumn = column;
+        _state = SKIP;
+        return false;
+    }
+
+    void startNumber()
+    {
+        _mantissa = 0;
+        _decimals = 0;
+        _fraction = false;
+        _negative = false;
+        _digits = false;
+    }
+
+    bool endNumber()
+    {
+        if (!_digits)
+        {
+            // A sign or point without digits, or a missing number after ','
+            if (_negative || _fraction || _operand > 0)
+                return fail("number expected", _column);
+            return true;
+        }
+        double value = _mantissa;
+        for (uint8_t i = 0; i < _decimals; i++)
+            value /= 10;
+        _values[_operand] = _negative ? -value : value;
+        _whole[_operand] = _decimals == 0;
+        _operands = _operand + 1;
+        return true;
+    }
+
+    // Append the command read, its limits are checked first so the error names the limit
+    bool emit()
+    {
+        if (!endNumber())
+            return false;
+
+        double value = _values[0];
+        double magnitude = value < 0 ? -value : value;
+        size_t before = _sequence.length();
+        switch (_command)
+        {
+        case 'f':
+        case 'b':
+            if (_operands > 0 && !_whole[0])
+                return fail("distance in whole mm expected", _tokenColumn);
+            if (_operands > 0 && magnitude > MAX_DISTANCE)
+                return fail("distance beyond MAX_DISTANCE", _tokenColumn);
+            if (_command == 'f')
+                _operands > 0 ? _sequence.f(static_cast<long>(value)) : _sequence.f();
+            else
+                _operands > 0 ? _sequence.b(static_cast<long>(value)) : _sequence.b();
+            break;
+        case 'l':
+        case 'r':
+        case 'p':
+            if (_operands > 0 && magnitude > MAX_ANGLE)
+                return fail("angle beyond MAX_ANGLE", _tokenColumn);
+            if (_command == 'l')
+                _operands > 0 ? _sequence.l(value) : _sequence.l();
+            else if (_command == 'r')
+                _operands > 0 ? _sequence.r(value) : _sequence.r();
+            else
+                _operands > 0 ? _sequence.pivot(value) : _sequence.pivot();
+            break;
+        case 's':
+            if (_operands == 0)
+                return fail("stop time expected", _tokenColumn);
+            if (!_whole[0] || value < 0 || value > 65535)
+                return fail("stop time of 0 to 65535 ms expected", _tokenColumn);
+            _sequence.stop(static_cast<unsigned long>(value));
+            break;
+        case 'a':
+            if (_operands == 0)
+                return fail("arc radius expected", _tokenColumn);
+            if (value < 0 || value > 65535)
+                return fail("arc radius of 0 to 65535 mm expected", _tokenColumn);
+            if (_operands > 1 && (_values[1] < -MAX_ANGLE || _values[1] > MAX_ANGLE))
+                return fail("angle beyond MAX_ANGLE", _tokenColumn);
+            // Checked on the radius and angle as the bytecode stores them, like CommandSequence::arc
+            if (arcOuterDistance(static_cast<long>(value + 0.5), _operands > 1 ? rounded(_values[1]) : 90, WHEEL_DISTANCE) > MAX_DISTANCE)
+                return fail("arc beyond MAX_DISTANCE", _tokenColumn);
+            _operands > 1 ? _sequence.arc(value, _values[1]) : _sequence.arc(value);
+            break;
+        }
+
+        if (_sequence.length() == before)
+            return fail("sequence longer than COMMAND_CODE_SIZE", _tokenColumn);
+        _command = 0;
+        return true;
+    }
+
+    // Finish the line, PARSE_EMPTY for a line without commands
+    Result endLine()
+    {
+        bool failed = _state == SKIP || (_command != 0 && !emit());
+        _state = IDLE;
+        _column = 0;
+        if (failed)
+            return PARSE_ERROR;
+        return _sequence.empty() ? PARSE_EMPTY : PARSE_DONE;
+    }
+
+public:
+    // Forget the parsed sequence and start a new one
+    void reset()
+    {
+        _sequence = CommandSequence();
+        _state = IDLE;
+        _command = 0;
+        _column = 0;
+        _error = nullptr;
+        _errorColumn = 0;
+    }
+
+    // Feed the next byte. After PARSE_DONE or PARSE_ERROR call reset() before the next line.
+    Result feed(char c)
+    {
+        if (c == '\n' || c == '\r')
+        {
+            // "\r\n" ends one line, not two
+            if (_column == 0 && _sequence.empty() && _state != SKIP)
+                return PARSE_MORE;
+            return endLine();
+        }
+
+        _column++;
+        switch (_state)
+        {
+        case COMMENT:
+        case SKIP:
+            return PARSE_MORE;
+
+        case IDLE:
+            c = lower(c);
+            if (isSeparator(c))
+                return PARSE_MORE;
+            if (c == '#')
+            {
+                _state = COMMENT;
+                return PARSE_MORE;
+            }
+            if (!isCommand(c))
+            {
+                fail("unknown command", _column);
+                return PARSE_MORE;
+            }
+            _command = c;
+            _tokenColumn = _column;
+            _operand = 0;
+            _operands = 0;
+            startNumber();
+            _state = COMMAND;
+            return PARSE_MORE;
+
+        case COMMAND:
+            if (c >= '0' && c <= '9')
+            {
+                if (_mantissa >= MAX_MANTISSA)
+                {
+                    fail("number too long", _column);
+                    return PARSE_MORE;
+                }
+                _mantissa = _mantissa * 10 + (c - '0');
+                _digits = true;
+                if (_fraction)
+                    _decimals++;
+                return PARSE_MORE;
+            }
+            if ((c == '-' || c == '+') && !_digits && !_negative && !_fraction)
+            {
+                _negative = c == '-';
+                return PARSE_MORE;
+            }
+            if (c == '.' && !_fraction)
+            {
+                _fraction = true;
+                return PARSE_MORE;
+            }
+            if (c == ',' && _command == 'a' && _operand == 0)
+            {
+                if (!endNumber())
+                    return PARSE_MORE;
+                if (!_digits)
+                {
+                    fail("arc radius expected", _column);
+                    return PARSE_MORE;
+                }
+                _operand = 1;
+                startNumber();
+                return PARSE_MORE;
+            }
+            if (isSeparator(c) || c == '#')
+            {
+                if (emit())
+                    _state = c == '#' ? COMMENT : IDLE;
+                return PARSE_MORE;
+            }
+            // Commands may follow each other without a space, e.g. "f500l"
+            if (isCommand(lower(c)))
+            {
+                if (emit())
+                {
+                    _state = IDLE;
+                    _column--;
+                    return feed(c);
+                }
+                return PARSE_MORE;
+            }
+            fail("unexpected character", _column);
+            return PARSE_MORE;
+        }
+        return PARSE_MORE;
+    }
+
+    const CommandSequence &sequence() const { return _sequence; }
+    // Why the line was rejected, null when it was not
+    const char *error() const { return _error; }
+    // Column of the rejected command or character, from 1
+    size_t errorColumn() const { return _errorColumn; }
+};
+
+#endif
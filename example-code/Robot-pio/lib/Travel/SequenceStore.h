@@ -0,0 +1,42 @@
+#ifndef SEQUENCE_STORE_H
+#define SEQUENCE_STORE_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "Commands.h"
+
+// Keeps an uploaded sequence in NVS as its bytecode, so it survives a restart
+class SequenceStore
+{
+private:
+    static constexpr const char *NAMESPACE = "sequence";
+    static constexpr const char *KEY = "uploaded";
+
+public:
+    static bool save(const CommandSequence &sequence)
+    {
+        Preferences prefs;
+        if (!prefs.begin(NAMESPACE, false))
+            return false;
+        bool saved = prefs.putBytes(KEY, sequence.code(), sequence.length()) == sequence.length();
+        prefs.end();
+        return saved;
+    }
+
+    // False when nothing was stored or the stored code is not valid
+    static bool load(CommandSequence *sequence)
+    {
+        Preferences prefs;
+        if (!prefs.begin(NAMESPACE, true))
+            return false;
+        uint8_t code[COMMAND_CODE_SIZE];
+        size_t length = prefs.getBytesLength(KEY);
+        bool loaded = length > 0 && length <= sizeof(code) &&
+                      prefs.getBytes(KEY, code, length) == length &&
+                      sequence->assign(code, length);
+        prefs.end();
+        return loaded;
+    }
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <esp_timer.h>
+#else
+#include <chrono>
+#include <thread>
+#endif
+
+// Monotonic microsecond timeline of a run. Commands are started at absolute times
+// from the start, so a late command shortens the wait before the next one instead
+// of pushing every later command back.
+class Timeline
+{
+private:
+    int64_t _start = 0;
+
+    static int64_t now()
+    {
+#ifdef ARDUINO
+        return esp_timer_get_time();
+#else
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+#endif
+    }
+
+public:
+    void start() { _start = now(); }
+
+    // Time since start, us
+    int64_t elapsed() const { return now() - _start; }
+
+    // Wait until at us after start. Sleeps in whole ticks and spins out the last one,
+    // so the wake up is not rounded to the 1 ms tick.
+    void waitUntil(int64_t at)
+    {
+#ifdef ARDUINO
+        int64_t remaining = at - elapsed();
+        if (remaining > 2000)
+            vTaskDelay(pdMS_TO_TICKS((remaining - 1000) / 1000));
+        while (elapsed() < at)
+        {
+        }
+#else
+        std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::microseconds(_start + at)));
+#endif
+    }
+};
+
+// Start time of every segment of a run on the timeline, us, so the run ends at targetTime ms.
+// counts: commands in each segment, expected: expected time of each segment, ms.
+// The time left over is spread evenly over the stops between commands, a blended run's
+// share goes to the stop after it, or before it when it ends the sequence.
+// Re-planned during the run from segment first on, at us after the start, once the
+// segments before it are done: the slack between the target and the expected finish is
+// spread over the stops still to come, so a command that ran long or short is made up by
+// all of them. Entries before first are 0.
+inline std::vector<int64_t> planStartTimes(const std::vector<size_t> &counts,
+                                           const std::vector<unsigned long> &expected,
+                                           unsigned long targetTime, size_t first = 0, int64_t at = 0)
+{
+    std::vector<int64_t> starts(counts.size(), 0);
+    if (first >= counts.size())
+        return starts;
+
+    // The last command has no stop after it
+    size_t stops = first > 0 ? counts[first - 1] - 1 : 0;
+    int64_t expectedTotal = 0;
+    for (size_t s = first; s < counts.size(); s++)
+    {
+        stops += counts[s];
+        expectedTotal += (int64_t)expected[s] * 1000;
+    }
+    if (first == 0)
+        stops--;
+    int64_t stopTotal = (int64_t)targetTime * 1000 - at - expectedTotal;
+    int64_t stopTime = stops > 0 && stopTotal > 0 ? stopTotal / (int64_t)stops : 0;
+
+    if (first > 0)
+        at += stopTime * counts[first - 1];
+    for (size_t s = first; s < counts.size(); s++)
+    {
+        bool endsSequence = s == counts.size() - 1;
+        if (endsSequence)
+            at += stopTime * (counts[s] - 1);
+        starts[s] = at;
+        at += (int64_t)expected[s] * 1000;
+        if (!endsSequence)
+            at += stopTime * counts[s];
+    }
+    return starts;
+}
+
+#endif
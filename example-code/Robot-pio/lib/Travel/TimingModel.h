@@ -0,0 +1,362 @@
+#ifndef TIMING_MODEL_H
+#define TIMING_MODEL_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "MotionTiming.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <Preferences.h>
+#include "Logger.h"
+#endif
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+// Turn angles learned, one running average per angle
+#define TIMING_TURN_ANGLES 16
+// Samples a running statistic weighs at most, older runs fade out beyond it
+#define TIMING_MAX_WEIGHT 20
+// Samples before a move or arc fit is trusted over the motion profile, and before outliers are rejected
+#define TIMING_MIN_FIT_SAMPLES 3
+// A sample further than this many standard deviations from the model is not learned
+#define TIMING_OUTLIER_SIGMA 3.0
+// Nor rejected when closer than this, so a model of near identical samples still follows the robot
+#define TIMING_OUTLIER_MIN_TIME 100.0 // ms
+#define TIMING_VERSION 2
+
+// Predicts the time of each command without running the motors.
+// Moves, arcs and step based turns follow their motion profiles. IMU turns end on the
+// measured angle, their time comes from the calibrated turn times, interpolated between
+// the calibrated angles and scaled with the turn profile outside them.
+//
+// The model learns from the runs: the measured time of every executed command is added to
+// running statistics kept in NVS, a line fitted to the profile times of moves and arcs and a
+// running average per turn angle, which replaces the calibrated time for that angle.
+// A time far outside what the model has seen, e.g. a turn that slipped, is left out.
+// Off the robot there is no NVS: load and save fail and nothing is reported.
+class TimingModel
+{
+private:
+    struct TurnPoint
+    {
+        double angle; // degrees
+        double time;  // ms
+    };
+
+    // Least squares line from the profile time to the measured time, ms
+    struct TimeFit
+    {
+        double n, sx, sy, sxx, sxy;
+        double residual; // running mean square of the measured time off the line, ms^2
+
+        void add(double x, double y)
+        {
+            double error = y - predict(x);
+            residual += (error * error - residual) / (n + 1 < TIMING_MAX_WEIGHT ? n + 1 : TIMING_MAX_WEIGHT);
+
+            // Fade the older samples out so the fit follows changes to the robot
+            if (n >= TIMING_MAX_WEIGHT)
+            {
+                double keep = (TIMING_MAX_WEIGHT - 1) / (double)TIMING_MAX_WEIGHT;
+                n *= keep;
+                sx *= keep;
+                sy *= keep;
+                sxx *= keep;
+                sxy *= keep;
+            }
+            n += 1;
+            sx += x;
+            sy += y;
+            sxx += x * x;
+            sxy += x * y;
+        }
+
+        // A fit with samples of a single length is only an offset
+        void line(double *slope, double *offset) const
+        {
+            *slope = 1;
+            *offset = 0;
+            if (n < 1)
+                return;
+            double spread = n * sxx - sx * sx;
+            if (n >= TIMING_MIN_FIT_SAMPLES && spread > n * n * 100)
+            {
+                double s = (n * sxy - sx * sy) / spread;
+                // Far off the profile is a bad sample, not the robot
+                if (s > 0.5 && s < 2)
+                {
+                    *slope = s;
+                    *offset = (sy - s * sx) / n;
+                    return;
+                }
+            }
+            *offset = (sy - sx) / n;
+        }
+
+        double predict(double profileTime) const
+        {
+            double slope, offset;
+            line(&slope, &offset);
+            return slope * profileTime + offset;
+        }
+
+        unsigned long apply(unsigned long profileTime) const
+        {
+            double time = predict(profileTime);
+            return time > 0 ? lround(time) : 0;
+        }
+
+        bool isOutlier(double x, double y) const
+        {
+            return n >= TIMING_MIN_FIT_SAMPLES && isFarOff(y - predict(x), residual);
+        }
+    };
+
+    struct TurnStat
+    {
+        int16_t angle; // 0.1 degree
+        uint16_t count;
+        float mean;     // ms
+        float variance; // ms^2
+    };
+
+    // Stored in NVS as one blob
+    struct TimingData
+    {
+        uint16_t version;
+        uint16_t turnCount;
+        TimeFit move;
+        TimeFit arc;
+        TurnStat turns[TIMING_TURN_ANGLES];
+    };
+
+    // Off the expected time by more than TIMING_OUTLIER_SIGMA standard deviations
+    static bool isFarOff(double error, double variance)
+    {
+        double limit = TIMING_OUTLIER_SIGMA * sqrt(variance);
+        return fabs(error) > (limit > TIMING_OUTLIER_MIN_TIME ? limit : TIMING_OUTLIER_MIN_TIME);
+    }
+
+    bool _useIMU;
+    std::vector<TurnPoint> _calibrated; // from the config, sorted by angle
+    std::vector<TurnPoint> _turns;      // calibrated and learned, sorted by angle
+    TimingData _data;
+    bool _changed;
+
+    // Time of a known point, scaled to another angle by the turn profile
+    double scaleFrom(const TurnPoint &point, double angle) const
+    {
+        double reference = estimateTurnTime(point.angle);
+        if (reference <= 0)
+            return point.time;
+        return point.time * estimateTurnTime(angle) / reference;
+    }
+
+    static bool byAngle(const TurnPoint &a, const TurnPoint &b)
+    {
+        return a.angle < b.angle;
+    }
+
+    // Learned angles take the place of the calibrated ones
+    void mergeTurns()
+    {
+        _turns.clear();
+        for (uint16_t i = 0; i < _data.turnCount; i++)
+            _turns.push_back({_data.turns[i].angle / 10.0, _data.turns[i].mean});
+        for (const TurnPoint &point : _calibrated)
+        {
+            bool learned = false;
+            for (uint16_t i = 0; i < _data.turnCount; i++)
+                learned = learned || _data.turns[i].angle == lround(point.angle * 10);
+            if (!learned)
+                _turns.push_back(point);
+        }
+        std::sort(_turns.begin(), _turns.end(), byAngle);
+    }
+
+    TurnStat *turnStat(int16_t angle)
+    {
+        for (uint16_t i = 0; i < _data.turnCount; i++)
+        {
+            if (_data.turns[i].angle == angle)
+                return &_data.turns[i];
+        }
+        if (_data.turnCount < TIMING_TURN_ANGLES)
+        {
+            TurnStat *stat = &_data.turns[_data.turnCount++];
+            *stat = {angle, 0, 0, 0};
+            return stat;
+        }
+
+        // Full, the angle seen least often makes room
+        TurnStat *least = &_data.turns[0];
+        for (uint16_t i = 1; i < _data.turnCount; i++)
+        {
+            if (_data.turns[i].count < least->count)
+                least = &_data.turns[i];
+        }
+        *least = {angle, 0, 0, 0};
+        return least;
+    }
+
+    const char *storageName() const
+    {
+        // IMU and step based turns take different times, each keeps its own model
+        return _useIMU ? "timing_imu" : "timing_step";
+    }
+
+public:
+    TimingModel(bool useIMU) : _useIMU(useIMU), _changed(false)
+    {
+        clear();
+    }
+
+    // Measured IMU turn times, ms by angle in degrees. Step based turns follow their profile.
+    void calibrate(const std::unordered_map<double, unsigned long> &turnTimes)
+    {
+        _calibrated.clear();
+        if (_useIMU)
+            for (const auto &pair : turnTimes)
+                _calibrated.push_back({fabs(pair.first), static_cast<double>(pair.second)});
+        std::sort(_calibrated.begin(), _calibrated.end(), byAngle);
+        mergeTurns();
+    }
+
+    // Forget what was learned, the stored model too on the next save
+    void clear()
+    {
+        memset(&_data, 0, sizeof(_data));
+        _data.version = TIMING_VERSION;
+        _changed = true;
+        mergeTurns();
+    }
+
+    bool load()
+    {
+#ifdef ARDUINO
+        Preferences prefs;
+        if (!prefs.begin(storageName(), true))
+            return false;
+        TimingData data;
+        bool loaded = prefs.getBytesLength("model") == sizeof(data) &&
+                      prefs.getBytes("model", &data, sizeof(data)) == sizeof(data) &&
+                      data.version == TIMING_VERSION && data.turnCount <= TIMING_TURN_ANGLES;
+        prefs.end();
+        if (!loaded)
+            return false;
+
+        _data = data;
+        _changed = false;
+        mergeTurns();
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Writes only after new samples, NVS writes stall the flash
+    bool save()
+    {
+        if (!_changed)
+            return true;
+#ifdef ARDUINO
+        Preferences prefs;
+        if (!prefs.begin(storageName(), false))
+            return false;
+        bool saved = prefs.putBytes("model", &_data, sizeof(_data)) == sizeof(_data);
+        prefs.end();
+        _changed = !saved;
+        return saved;
+#else
+        return false;
+#endif
+    }
+
+    // The record functions return false when the time is an outlier and was not learned
+    bool recordMove(long distance, unsigned long duration, unsigned long actual)
+    {
+        double profileTime = estimateMoveTime(distance, duration);
+        if (_data.move.isOutlier(profileTime, actual))
+            return false;
+        _data.move.add(profileTime, actual);
+        _changed = true;
+        return true;
+    }
+
+    bool recordArc(double radius, double angle, unsigned long duration, unsigned long actual)
+    {
+        double profileTime = estimateArcTime(radius, angle, duration);
+        if (_data.arc.isOutlier(profileTime, actual))
+            return false;
+        _data.arc.add(profileTime, actual);
+        _changed = true;
+        return true;
+    }
+
+    bool recordTurn(double angle, unsigned long actual)
+    {
+        TurnStat *stat = turnStat(lround(fabs(angle) * 10));
+        if (stat->count >= TIMING_MIN_FIT_SAMPLES && isFarOff(actual - stat->mean, stat->variance))
+            return false;
+        if (stat->count < TIMING_MAX_WEIGHT)
+            stat->count++;
+        float delta = actual - stat->mean;
+        stat->mean += delta / stat->count;
+        stat->variance += (delta * (actual - stat->mean) - stat->variance) / stat->count;
+        _changed = true;
+        mergeTurns();
+        return true;
+    }
+
+    unsigned long moveTime(long distance, unsigned long duration = 0) const
+    {
+        return _data.move.apply(estimateMoveTime(distance, duration));
+    }
+
+    unsigned long arcTime(double radius, double angle, unsigned long duration = 0) const
+    {
+        return _data.arc.apply(estimateArcTime(radius, angle, duration));
+    }
+
+    unsigned long turnTime(double angle) const
+    {
+        angle = fabs(angle);
+        if (_turns.empty())
+            return estimateTurnTime(angle);
+
+        if (angle <= _turns.front().angle)
+            return lround(scaleFrom(_turns.front(), angle));
+        if (angle >= _turns.back().angle)
+            return lround(scaleFrom(_turns.back(), angle));
+
+        size_t i = 1;
+        while (_turns[i].angle < angle)
+            i++;
+        const TurnPoint &a = _turns[i - 1];
+        const TurnPoint &b = _turns[i];
+        return lround(a.time + (b.time - a.time) * (angle - a.angle) / (b.angle - a.angle));
+    }
+
+    void report() const
+    {
+#ifdef ARDUINO
+        double slope, offset;
+        _data.move.line(&slope, &offset);
+        logger.info("Timing model: moves %F x profile + %F ms, %F samples", slope, offset, _data.move.n);
+        _data.arc.line(&slope, &offset);
+        logger.info("Timing model: arcs %F x profile + %F ms, %F samples", slope, offset, _data.arc.n);
+        for (uint16_t i = 0; i < _data.turnCount; i++)
+        {
+            const TurnStat &stat = _data.turns[i];
+            logger.info("Timing model: turn %D deg %F ms, std %F ms, %d samples",
+                        stat.angle / 10.0, stat.mean, sqrt(stat.variance), stat.count);
+        }
+#endif
+    }
+};
+
+#endif
@@ -5,6 +5,10 @@
 #include "Robot.h"
 #include "Logger.h"
 #include "Commands.h"
+#include "Lookahead.h"
+#include "Optimizer.h"
+#include "Timeline.h"
+#include "TimingModel.h"
 #include "Modes.h"
 
 #include <vector>
@@ -14,21 +18,454 @@ class Travel
 {
 private:
     Robot _robot;
-    const CommandSequence *_commands;
+    TimingModel _timing;
+    std::vector<Command> _program; // the loaded sequence, decoded
+    std::vector<Segment> _segments;
+    RampArena _ramps;
+    std::vector<StepProfile> _profiles; // per command, ramp is null when not precomputed
+    std::vector<unsigned long> _durations; // per command, time given to a timed move, 0 for full speed
     unsigned long _totalStopTime;
-    unsigned long _dryRunStopTime;
+    unsigned long _stopBudget; // part of the total stop time spent on stops between commands
+    std::vector<unsigned long> _expected; // per segment, expected time, ms
+    unsigned long _targetRunTime;         // set target, 0 for the expected run time plus the stop time
+    unsigned long _targetTime;            // target of the current run, ms
+    Timeline _timeline;
+    std::vector<int64_t> _deadlines; // per segment, start time on the timeline, us
+    int64_t _maxMiss;                // latest start of the run, us
+    size_t _missCount;               // segments started late
     bool _dryRun;
     bool _useIMU;
+    bool _blendMoves;
+    bool _timedMoves;
+    bool _optimize;
+    bool _learnTiming;
     Mode _mode;
     static const unsigned long MAX_STOP_TIME = 60000;
 
+    // Length driven by a segment, mm, 0 for turns and stops
+    double segmentLength(const Segment &seg) const
+    {
+        const Command &cmd = _program[seg.first];
+        if (cmd.op == OP_MOVE)
+            return abs(seg.distance);
+        if (isArc(cmd))
+            return (arcRadius(cmd) + WHEEL_DISTANCE / 2) * abs(cmd.value) * PI / 180.0;
+        return 0;
+    }
+
+    unsigned long segmentTime(const Segment &seg, unsigned long duration)
+    {
+        const Command &cmd = _program[seg.first];
+        if (isArc(cmd))
+            return _timing.arcTime(arcRadius(cmd), cmd.value, duration);
+        return _timing.moveTime(seg.distance, duration);
+    }
+
+    // In timed mode the stop time is spent driving slower rather than standing still:
+    // each move and arc gets a share in proportion to its length, and only what the
+    // moves cannot absorb is left for the stops between commands
+    void planDurations()
+    {
+        const std::vector<Command> &cmds = _program;
+        _durations.assign(cmds.size(), 0);
+        _stopBudget = _totalStopTime;
+        if (!_timedMoves || _totalStopTime == 0)
+            return;
+
+        double totalLength = 0;
+        for (const Segment &seg : _segments)
+            totalLength += segmentLength(seg);
+        if (totalLength == 0)
+            return;
+
+        unsigned long spent = 0;
+        for (const Segment &seg : _segments)
+        {
+            double length = segmentLength(seg);
+            if (length == 0)
+                continue;
+
+            unsigned long fastest = segmentTime(seg, 0);
+            unsigned long duration = fastest + lround(_totalStopTime * length / totalLength);
+            _durations[seg.first] = duration;
+            // Moves are not slowed below MOVE_MIN_SPEED, so a share may not be used up
+            spent += segmentTime(seg, duration) - fastest;
+        }
+        _stopBudget = spent < _totalStopTime ? _totalStopTime - spent : 0;
+        logger.info("Timed moves: %u ms of the stop time spent driving slower, %u ms left for stops",
+                    spent, _stopBudget);
+    }
+
+    // Build the step ramps of every move, turn and arc now, so execution does no ramp math.
+    // A blended run of moves gets one ramp for its total distance, kept at its first command.
+    // Once the arena is full, commands can still share a ramp already in it.
+    void planRamps()
+    {
+        const std::vector<Command> &cmds = _program;
+        _ramps.clear();
+        _profiles.assign(cmds.size(), StepProfile());
+
+        size_t missing = 0;
+        for (const Segment &seg : _segments)
+        {
+            const Command &cmd = cmds[seg.first];
+            bool planned = true;
+            if (cmd.op == OP_MOVE)
+                planned = _robot.planMove(seg.distance, _ramps, &_profiles[seg.first], _durations[seg.first]);
+            else if (cmd.op == OP_TURN)
+                planned = _robot.planTurn(cmd.value, _ramps, &_profiles[seg.first]);
+            else if (isArc(cmd))
+                planned = _robot.planArc(arcRadius(cmd), cmd.value, _ramps, &_profiles[seg.first], _durations[seg.first]);
+
+            if (!planned)
+            {
+                if (missing == 0)
+                    logger.error("Ramp arena full at command %d", seg.first);
+                missing++;
+            }
+        }
+        logger.info("Ramp tables: %d ramps, %u intervals", _ramps.count(), _ramps.used());
+        if (missing > 0)
+        {
+            // Built at run time their ramps cost the ramp math the arena is there to avoid
+            logger.error("%d commands build their ramps at run time, raise RAMP_ARENA_SIZE or RAMP_ARENA_ENTRIES", missing);
+        }
+    }
+
+    static bool isArc(const Command &cmd)
+    {
+        return cmd.op == OP_ARC || cmd.op == OP_PIVOT;
+    }
+
+    // A pivot is an arc around one wheel
+    static double arcRadius(const Command &cmd)
+    {
+        return cmd.op == OP_PIVOT ? WHEEL_DISTANCE / 2 : cmd.radius;
+    }
+
+    // Log the time of each arc against the move-turn-move chain that ends at the same pose
+    void reportArcs()
+    {
+        const std::vector<Command> &cmds = _program;
+        for (size_t i = 0; i < cmds.size(); i++)
+        {
+            if (!isArc(cmds[i]) || abs(cmds[i].value) >= 180)
+                continue;
+
+            double radius = arcRadius(cmds[i]);
+            long tangent = lround(radius * tan(abs(cmds[i].value) * PI / 360.0));
+            long arcTime = estimateArcTime(radius, cmds[i].value);
+            long chainTime = 2 * estimateMoveTime(tangent) + estimateTurnTime(cmds[i].value);
+            logger.info("Arc command %d: %d ms, %d ms as move %d mm, turn, move %d mm, %d ms saved",
+                        i, arcTime, chainTime, tangent, tangent, chainTime - arcTime);
+        }
+    }
+
+    // Log the blended runs, their junction speeds and the time saved by not stopping at each move
+    void reportBlending()
+    {
+        const std::vector<Command> &cmds = _program;
+        long savedTime = 0;
+        for (const Segment &seg : _segments)
+        {
+            if (seg.count < 2)
+                continue;
+
+            long separateTime = 0;
+            long position = 0;
+            for (size_t i = seg.first; i < seg.first + seg.count; i++)
+            {
+                long distance = static_cast<long>(cmds[i].value);
+                separateTime += estimateMoveTime(distance);
+                position += abs(distance);
+                if (i < seg.first + seg.count - 1)
+                {
+                    double speed = LookaheadPlanner::junctionSpeed(position * MICRO_STEPS, abs(seg.distance) * MICRO_STEPS,
+                                                                   MOVE_SPEED, MOVE_ACCEL) / MICRO_STEPS;
+                    logger.info("Junction after command %d at %d mm: %D mm/s", i, position, speed);
+                }
+            }
+            long blendedTime = estimateMoveTime(seg.distance);
+            logger.info("Commands %d-%d blended into one %d mm move, %d ms saved",
+                        seg.first, seg.first + seg.count - 1, seg.distance, separateTime - blendedTime);
+            savedTime += separateTime - blendedTime;
+        }
+        logger.info("Look-ahead: %d commands in %d segments, %d ms saved",
+                    cmds.size(), _segments.size(), savedTime);
+    }
+
+    void pause(unsigned long duration)
+    {
+        if (duration > 0)
+            _robot.stop(duration);
+    }
+
+    // Expected time of one command run on its own, ms
+    unsigned long commandTime(const Command &cmd)
+    {
+        switch (cmd.op)
+        {
+        case OP_MOVE:
+            return _timing.moveTime(static_cast<long>(cmd.value));
+        case OP_TURN:
+            return _timing.turnTime(cmd.value);
+        case OP_ARC:
+        case OP_PIVOT:
+            return _timing.arcTime(arcRadius(cmd), cmd.value);
+        case OP_STOP:
+            return static_cast<unsigned long>(cmd.value);
+        }
+        return 0;
+    }
+
+    unsigned long sequenceTime(const std::vector<Command> &commands)
+    {
+        unsigned long total = 0;
+        for (const Command &cmd : commands)
+            total += commandTime(cmd);
+        return total;
+    }
+
+    // Expected time of every segment, the model the run is tracked against
+    void planExpectedTimes()
+    {
+        const std::vector<Command> &cmds = _program;
+        _expected.assign(_segments.size(), 0);
+        unsigned long total = 0;
+        for (size_t i = 0; i < _segments.size(); i++)
+        {
+            const Segment &seg = _segments[i];
+            const Command &cmd = cmds[seg.first];
+            switch (cmd.op)
+            {
+            case OP_MOVE:
+            case OP_ARC:
+            case OP_PIVOT:
+                _expected[i] = segmentTime(seg, _durations[seg.first]);
+                break;
+            case OP_TURN:
+                _expected[i] = _timing.turnTime(cmd.value);
+                break;
+            case OP_STOP:
+                _expected[i] = static_cast<unsigned long>(cmd.value);
+                break;
+            }
+            total += _expected[i];
+        }
+        logger.info("Expected run time: %u ms driving, %u ms stops", total, _stopBudget);
+    }
+
+    // Expected time of the segments from first to the end, ms
+    unsigned long remainingTime(size_t first) const
+    {
+        unsigned long total = 0;
+        for (size_t i = first; i < _expected.size(); i++)
+            total += _expected[i];
+        return total;
+    }
+
+    // Time since the run started, us
+    int64_t elapsedUs() const
+    {
+        return _timeline.elapsed();
+    }
+
+    unsigned long elapsed() const
+    {
+        return elapsedUs() / 1000;
+    }
+
+    // Start time of every segment on the timeline, see planStartTimes. Before the run, and
+    // after each segment for the segments from first on, so the slack is re-budgeted.
+    void planDeadlines(size_t first = 0)
+    {
+        std::vector<size_t> counts;
+        for (const Segment &seg : _segments)
+            counts.push_back(seg.count);
+        _deadlines = planStartTimes(counts, _expected, _targetTime, first, first > 0 ? elapsedUs() : 0);
+    }
+
+    // Wait for the start time of a segment, or log how late it is
+    void waitForDeadline(size_t segment)
+    {
+        int64_t now = elapsedUs();
+        int64_t deadline = _deadlines[segment];
+        if (now > deadline)
+        {
+            int64_t miss = now - deadline;
+            _missCount++;
+            if (miss > _maxMiss)
+                _maxMiss = miss;
+            logger.info("Segment %d starts %l us late", segment, (long)miss);
+            return;
+        }
+
+        logger.info("Stopping for %l us until segment %d", (long)(deadline - now), segment);
+        _timeline.waitUntil(deadline);
+    }
+
+    void logProgress(size_t segment)
+    {
+        unsigned long now = elapsed();
+        long slack = (long)_targetTime - (long)now - (long)remainingTime(segment + 1);
+        unsigned long finish = now + remainingTime(segment + 1) + (slack > 0 ? slack : 0);
+        logger.info("Segment %d done at %u ms, predicted finish %u ms, target %u ms, slack %d ms",
+                    segment, now, finish, _targetTime, slack);
+    }
+
+    // Add the measured time of a segment to the timing model. Stops take their own time.
+    void recordSegment(size_t segment, unsigned long actual)
+    {
+        const Segment &seg = _segments[segment];
+        const Command &cmd = _program[seg.first];
+        bool learned = true;
+        switch (cmd.op)
+        {
+        case OP_MOVE:
+            learned = _timing.recordMove(seg.distance, _durations[seg.first], actual);
+            break;
+        case OP_TURN:
+            learned = _timing.recordTurn(cmd.value, actual);
+            break;
+        case OP_ARC:
+        case OP_PIVOT:
+            learned = _timing.recordArc(arcRadius(cmd), cmd.value, _durations[seg.first], actual);
+            break;
+        case OP_STOP:
+            break;
+        }
+        if (!learned)
+            logger.warn("Segment %d took %u ms, far off the timing model, not learned", segment, actual);
+    }
+
+    const StepProfile *profileFor(size_t i) const
+    {
+        return _profiles[i].ramp != nullptr ? &_profiles[i] : nullptr;
+    }
+
+    // Run one segment, returns false on an unknown command.
+    // finished is set false when the motion was refused or cut short.
+    // Motion runs on the motion task, the commands are logged while it moves.
+    bool executeSegment(const Segment &seg, bool *finished)
+    {
+        const std::vector<Command> &commands = _program;
+        const Command &cmd = commands[seg.first];
+        std::vector<long> distances;
+        MotionHandle motion;
+
+        if (seg.count > 1)
+        {
+            for (size_t i = seg.first; i < seg.first + seg.count; i++)
+                distances.push_back(static_cast<long>(commands[i].value));
+            motion = _robot.moveBlendedAsync(distances.data(), distances.size(), profileFor(seg.first),
+                                             _durations[seg.first]);
+        }
+        else
+        {
+            switch (cmd.op)
+            {
+            case OP_MOVE:
+                motion = _robot.moveAsync(static_cast<long>(cmd.value), profileFor(seg.first), _durations[seg.first]);
+                break;
+            case OP_TURN:
+                motion = _robot.turnAsync(cmd.value, profileFor(seg.first));
+                break;
+            case OP_ARC:
+            case OP_PIVOT:
+                motion = _robot.arcAsync(arcRadius(cmd), cmd.value, profileFor(seg.first), _durations[seg.first]);
+                break;
+            case OP_STOP:
+                pause(static_cast<unsigned long>(cmd.value));
+                break;
+            default:
+                logger.error("Unknown command: %d", cmd.op);
+                logger.lcdPrint("Unknown command");
+                return false;
+            }
+        }
+
+        logger.info("--------------------------------");
+        for (size_t i = seg.first; i < seg.first + seg.count; i++)
+        {
+            if (isArc(commands[i]))
+                logger.info("Executing command %d: type=%s, value=%D, radius=%D",
+                            i, opcodeName(commands[i].op), commands[i].value, arcRadius(commands[i]));
+            else
+                logger.info("Executing command %d: type=%s, value=%D",
+                            i, opcodeName(commands[i].op), commands[i].value);
+        }
+        motion.wait();
+        *finished = logMotionLatency();
+        return true;
+    }
+
+    // Run time of the loaded sequence: the expected segment times plus the stops, or the target
+    unsigned long predictedTime() const
+    {
+        unsigned long expected = remainingTime(0) + _stopBudget;
+        return _targetRunTime > expected ? _targetRunTime : expected;
+    }
+
+    // Dry run: log the expected time of every segment and show the run time, without moving
+    void predict()
+    {
+        const std::vector<Command> &commands = _program;
+        logger.info("--------------------------------");
+        for (size_t s = 0; s < _segments.size(); s++)
+        {
+            const Segment &seg = _segments[s];
+            logger.info("Segment %d: %d command(s) from %s %D, %u ms",
+                        s, seg.count, opcodeName(commands[seg.first].op), commands[seg.first].value, _expected[s]);
+        }
+
+        float totalSeconds = predictedTime() / 1000.0;
+        logger.lcdSet(COLOR_GREEN);
+        logger.lcdPrintf("Predicted:\n%.2f s", totalSeconds);
+        logger.info("================================================");
+        logger.info("Total extra stop time: %F seconds", _totalStopTime / 1000.0);
+        logger.info("Predicted run time %F seconds", totalSeconds);
+        if (_targetRunTime > 0)
+        {
+            unsigned long driving = remainingTime(0);
+            logger.info("Stop time to reach the target: %u ms", _targetRunTime > driving ? _targetRunTime - driving : 0);
+        }
+        logger.info("================================================");
+    }
+
+    // Log the timing of the finished motion, returns false when any of it was refused or cut short
+    bool logMotionLatency()
+    {
+        bool finished = true;
+        MotionCompletion done;
+        while (_robot.popMotionCompletion(&done))
+        {
+            finished = finished && done.finished;
+            if (done.firstStepAt != 0)
+                logger.info("Motion %u: dequeued after %u us, first step after %u us, done in %u ms",
+                            done.id, done.startedAt - done.enqueuedAt, done.firstStepAt - done.enqueuedAt,
+                            (done.finishedAt - done.enqueuedAt) / 1000);
+            else
+                logger.info("Motion %u: dequeued after %u us, done in %u ms",
+                            done.id, done.startedAt - done.enqueuedAt, (done.finishedAt - done.enqueuedAt) / 1000);
+        }
+        return finished;
+    }
+
 public:
     Travel(bool useIMU = true) : _robot(),
-                                 _commands(nullptr),
+                                 _timing(useIMU),
                                  _totalStopTime(0),
-                                 _dryRunStopTime(0),
+                                 _stopBudget(0),
+                                 _targetRunTime(0),
+                                 _targetTime(0),
+                                 _maxMiss(0),
+                                 _missCount(0),
                                  _dryRun(false),
                                  _useIMU(useIMU),
+                                 _blendMoves(true),
+                                 _timedMoves(false),
+                                 _optimize(true),
+                                 _learnTiming(true),
                                  _mode(Mode::TEST)
     {
         _robot.setUseIMU(useIMU);
@@ -36,10 +473,106 @@ public:
 
     void loadCommandSequence(const CommandSequence &commands)
     {
-        _commands = &commands;
+        if (commands.overflow())
+            logger.error("Command sequence longer than %d bytes", COMMAND_CODE_SIZE);
+        if (!commands.valid())
+        {
+            // Only a sequence built at run time gets here, a constexpr one does not compile
+            logger.error("Command sequence breaks a limit, not loaded");
+            logger.lcdPrint("Invalid\nsequence", COLOR_RED);
+            _program.clear();
+            _segments.clear();
+            return;
+        }
+
+        // Decoded once here, execution switches on the opcodes
+        _program.clear();
+        _program.reserve(commands.size());
+        CommandReader reader(commands);
+        Command cmd;
+        while (reader.next(&cmd))
+            _program.push_back(cmd);
+        if (!reader.atEnd())
+            logger.error("Invalid opcode after command %d", _program.size());
+
+        // The build only checks the middle of an arc, WHEEL_DISTANCE is not known before
+        for (size_t i = 0; i < _program.size(); i++)
+        {
+            const Command &arc = _program[i];
+            if (arc.op == OP_ARC && arcOuterDistance(arc.radius, arc.value, WHEEL_DISTANCE) > MAX_DISTANCE)
+            {
+                logger.error("Arc command %d: outer wheel beyond MAX_DISTANCE, not loaded", i);
+                logger.lcdPrint("Invalid\nsequence", COLOR_RED);
+                _program.clear();
+                _segments.clear();
+                return;
+            }
+        }
+
+        // TEST mode runs calibration sequences, e.g. eight l(), that must run as written
+        if (_optimize && _mode != Mode::TEST)
+        {
+            const char *warning;
+            std::vector<Command> optimized = SequenceOptimizer::optimize(_program, &warning);
+            if (warning != nullptr)
+                logger.warn("Optimizer: %s", warning);
+            logger.info("Optimizer: %d commands, %u ms before, %d commands, %u ms after",
+                        _program.size(), sequenceTime(_program), optimized.size(), sequenceTime(optimized));
+            _program.swap(optimized);
+        }
+
+        _segments = LookaheadPlanner::plan(_program, _blendMoves);
+        planDurations();
+        planExpectedTimes();
+        planRamps();
+        reportBlending();
+        reportArcs();
+        logger.info("Predicted run time: %u ms", predictedTime());
         logger.info("New command sequence loaded");
     }
 
+    // Merge and simplify the commands of a sequence when it is loaded, not in TEST mode
+    void setOptimize(bool optimize = true)
+    {
+        _optimize = optimize;
+    }
+
+    // Learn the command times from the runs, kept in NVS
+    void setLearnTiming(bool learn = true)
+    {
+        _learnTiming = learn;
+    }
+
+    // Forget the learned command times and go back to DRY_RUN_STOP_TIMES
+    void resetTiming()
+    {
+        _timing.clear();
+        _timing.save();
+        logger.info("Timing model reset");
+    }
+
+    // Run consecutive same-direction moves without stopping between them
+    void setBlendMoves(bool blend = true)
+    {
+        _blendMoves = blend;
+    }
+
+    // Spend the total stop time driving slower instead of stopping between commands.
+    // Set before loading the sequence, like the total stop time.
+    void setTimedMoves(bool timed = true)
+    {
+        _timedMoves = timed;
+    }
+
+    // Run time to finish at, ms. Every command gets a start time counted from the start of
+    // the run (see planDeadlines), re-planned after each command, so a command that runs long
+    // or short is absorbed by the stops after it instead of shifting the rest of the run.
+    // Without it the target is the expected run time plus the total stop time.
+    void setTargetRunTime(unsigned long duration)
+    {
+        _targetRunTime = duration;
+    }
+
     void setTotalStopTime(unsigned long duration)
     {
         _totalStopTime = min(duration, MAX_STOP_TIME);
@@ -58,6 +591,11 @@ public:
         if (_mode != Mode::DRY_RUN)
             _robot.startLasers();
         _robot.startIMU();
+        // Not in the constructor: travel is a global, DRY_RUN_STOP_TIMES may not be built yet
+        _timing.calibrate(DRY_RUN_STOP_TIMES);
+        if (_timing.load())
+            logger.info("Timing model loaded");
+        _timing.report();
     }
 
     void close()
@@ -79,12 +617,18 @@ public:
             _robot.stopLasers();
         }
 
-        if (_commands == nullptr || _commands->getCommands().empty())
+        if (_program.empty())
         {
             logger.error("No commands loaded");
             return;
         }
 
+        if (_dryRun)
+        {
+            predict();
+            return;
+        }
+
         logger.info("Starting command sequence in 2 seconds");
         logger.lcdPrint("Starting\nin 2 s", COLOR_YELLOW);
 
@@ -92,102 +636,45 @@ public:
 
         logger.lcdPrint("Running", COLOR_RED);
 
-        unsigned long startTime = millis();
+        _maxMiss = 0;
+        _missCount = 0;
+        _targetTime = _targetRunTime > 0 ? _targetRunTime : remainingTime(0) + _stopBudget;
+        planDeadlines();
+        _timeline.start();
 
-        const std::vector<Command> &commands = _commands->getCommands();
-        for (size_t i = 0; i < commands.size(); i++)
+        for (size_t s = 0; s < _segments.size(); s++)
         {
-            const Command &cmd = commands[i];
-            logger.info("--------------------------------");
-            logger.info("Executing command %d: type=%s, value=%D",
-                        i, cmd.action.c_str(), cmd.value);
-
-            if (cmd.action == "move")
-            {
-                _robot.move(static_cast<long>(cmd.value));
-            }
-            else if (cmd.action == "turn")
-            {
-                if (_dryRun)
-                {
-                    // In dry run mode, use predefined stop times based on angle
-                    auto it = DRY_RUN_STOP_TIMES.find(abs(cmd.value));
-                    if (it != DRY_RUN_STOP_TIMES.end())
-                    {
-                        // _robot.stop(it->second);
-                        _dryRunStopTime += it->second;
-                    }
-                    else
-                    {
-                        // Find the closest angle in the map
-                        double closestAngle = 45; // Initialize with smallest angle
-                        double minDiff = 180;     // Initialize with maximum possible difference
-                        double targetAngle = abs(cmd.value);
-
-                        for (const auto &pair : DRY_RUN_STOP_TIMES)
-                        {
-                            double diff = abs(pair.first - targetAngle);
-                            if (diff < minDiff)
-                            {
-                                minDiff = diff;
-                                closestAngle = pair.first;
-                            }
-                        }
-
-                        // _robot.stop(DRY_RUN_STOP_TIMES.at(closestAngle));
-                        _dryRunStopTime += DRY_RUN_STOP_TIMES.at(closestAngle);
-                    }
-                }
-                else
-                {
-                    _robot.turn(cmd.value);
-                }
-            }
-            else if (cmd.action == "stop")
-            {
-                if (_dryRun)
-                {
-                    _dryRunStopTime += static_cast<unsigned long>(cmd.value);
-                }
-                else
-                {
-                    _robot.stop(static_cast<unsigned long>(cmd.value));
-                }
-            }
-            else
-            {
-                logger.error("Unknown command: %s", cmd.action.c_str());
-                logger.lcdPrint("Unknown command");
+            waitForDeadline(s);
+            int64_t start = elapsedUs();
+            bool finished = true;
+            if (!executeSegment(_segments[s], &finished))
                 return;
-            }
-
-            // If this isn't the last command, delay for a portion of the total stop time
-            if (i < commands.size() - 1)
-            {
-                unsigned long stopTime = _totalStopTime / (commands.size() - 1);
-                if (_dryRun)
-                {
-                    _dryRunStopTime += stopTime;
-                }
-                else
-                {
-                    _robot.stop(stopTime);
-                }
-            }
-        }
-        unsigned long totalTime = millis() - startTime;
-        if (_dryRun)
-        {
-            totalTime += _dryRunStopTime;
-            _dryRunStopTime = 0;
+            // A timed out or refused command did not take the time of the command
+            if (_learnTiming && finished)
+                recordSegment(s, (elapsedUs() - start) / 1000);
+            else if (_learnTiming)
+                logger.warn("Segment %d cut short, not learned", s);
+            logProgress(s);
+            planDeadlines(s + 1);
         }
+        unsigned long totalTime = elapsed();
         float totalSeconds = totalTime / 1000.0;
         logger.lcdSet(COLOR_GREEN);
         logger.lcdPrintf("RunTime:\n%.2f s", totalSeconds);
         logger.info("================================================");
         logger.info("Total extra stop time: %F seconds", _totalStopTime / 1000.0);
         logger.info("Total run time %F seconds", totalSeconds);
+        logger.info("Target run time %F seconds, error %d ms", _targetTime / 1000.0, (long)totalTime - (long)_targetTime);
+        logger.info("Segments started late: %d of %d, latest by %l us", _missCount, _segments.size(), (long)_maxMiss);
         logger.info("================================================");
+
+        // After the run, writing NVS stalls the flash
+        if (_learnTiming)
+        {
+            if (!_timing.save())
+                logger.warn("Timing model not saved");
+            _timing.report();
+        }
     }
 };
 
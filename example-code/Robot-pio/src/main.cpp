@@ -3,6 +3,8 @@
 
 #include <ezButton.h>
 #include "Travel.h"
+#include "SequenceParser.h"
+#include "SequenceStore.h"
 #include "Logger.h"
 #include "config.h"
 #include "Modes.h"
@@ -23,12 +25,44 @@ ezButton startButton(START_BUTTON);
 Mode currentMode = Mode::TEST;
 String modeName = "TEST";
 bool isModeSelected = false; // Add flag to track if mode has been selected
-CommandSequence *sequence = &testSequence;
+const CommandSequence *sequence = &testSequence;
+
+// Sequence sent over Serial, kept in flash
+SequenceParser parser;
+CommandSequence uploadedSequence;
+
+// Read a sequence typed in the serial monitor, one line, e.g. "f500 l r90 b300 s2000"
+void readSerial()
+{
+    while (Serial.available() > 0)
+    {
+        SequenceParser::Result result = parser.feed(Serial.read());
+        if (result == SequenceParser::PARSE_MORE)
+            continue;
+
+        if (result == SequenceParser::PARSE_DONE)
+        {
+            uploadedSequence = parser.sequence();
+            if (!SequenceStore::save(uploadedSequence))
+                logger.warn("Uploaded sequence not saved to flash");
+            logger.info("Sequence uploaded: %d commands, %d bytes", uploadedSequence.size(), uploadedSequence.length());
+            logger.lcdPrintf("UPLOADED:\n%d cmds", uploadedSequence.size());
+        }
+        else if (result == SequenceParser::PARSE_ERROR)
+        {
+            logger.error("Sequence rejected at column %d: %s", parser.errorColumn(), parser.error());
+            logger.lcdPrint("Upload\nfailed", COLOR_RED);
+        }
+        parser.reset();
+    }
+}
 
 void setup()
 {
     modeButton.setDebounceTime(50);
     startButton.setDebounceTime(50);
+    if (SequenceStore::load(&uploadedSequence))
+        logger.info("Uploaded sequence: %d commands", uploadedSequence.size());
     logger.info("Setup complete, press the mode button");
     logger.lcdPrint("Press\nmode\nbutton");
 }
@@ -38,11 +72,12 @@ void loop()
     // Must call these every loop for proper debouncing
     modeButton.loop();
     startButton.loop();
+    readSerial();
 
     // Toggle mode when mode button is released
     if (modeButton.isReleased())
     {
-        currentMode = static_cast<Mode>((currentMode + 1) % 3);
+        currentMode = static_cast<Mode>((currentMode + 1) % MODE_COUNT);
         switch (currentMode)
         {
         case Mode::TEST:
@@ -61,7 +96,13 @@ void loop()
             modeName = "DRY RUN";
             logger.lcdSet(COLOR_YELLOW);
             sequence = &runSequence;
-            travel.setDryRun(useIMU ? true : false);
+            travel.setDryRun(true);
+            break;
+        case Mode::UPLOADED:
+            modeName = "UPLOAD";
+            logger.lcdSet(COLOR_CYAN);
+            sequence = &uploadedSequence;
+            travel.setDryRun(false);
             break;
         }
         travel.setMode(currentMode);
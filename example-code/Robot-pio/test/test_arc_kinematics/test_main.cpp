@@ -0,0 +1,133 @@
+// Arc kinematics: the wheel steps of an arc, run on the step engine's virtual timer
+// and integrated as a differential drive, must end at the arc's pose, and the arc
+// must beat the move-turn-move chain that ends at the same pose.
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include "StepEngine.h"
+#include "MotionTiming.h"
+
+// Set in src/config.cpp on the robot
+const double WHEEL_DISTANCE = 155.8; // mm
+
+// Where the middle of the robot is, x forward and y to the right of the start, mm
+struct Pose
+{
+    double x;
+    double y;
+    double heading; // degrees, positive to the right
+};
+
+static StepEngine engine;
+static Pose pose;
+
+static void onPulse(uint8_t mask, uint64_t timeUs, void *context)
+{
+    (void)timeUs;
+    Pose &p = *(Pose *)context;
+    // Forward distance of each wheel. As in Robot, a move forward steps STEP_LEFT forward
+    // and the inverted STEP_RIGHT backward, and a turn to the right steps both backward:
+    // STEP_LEFT is the wheel on the inside of a turn to the right.
+    double inside = (mask & (1 << STEP_LEFT)) ? engine.position(STEP_LEFT) > 0 ? 1 : -1 : 0;
+    double outside = (mask & (1 << STEP_RIGHT)) ? engine.position(STEP_RIGHT) < 0 ? 1 : -1 : 0;
+    inside /= STEPS_PER_MM;
+    outside /= STEPS_PER_MM;
+
+    double turn = (outside - inside) / WHEEL_DISTANCE;
+    double middle = p.heading * M_PI / 180 + turn / 2;
+    p.x += (inside + outside) / 2 * cos(middle);
+    p.y += (inside + outside) / 2 * sin(middle);
+    p.heading += turn * 180 / M_PI;
+}
+
+// Run wheel steps with the given limits, returns the time to the end of the move in s
+static float drive(long leftSteps, long rightSteps, float speed, float accel, float jerk)
+{
+    engine.configure(speed, accel, jerk);
+    uint64_t start = engine.virtualNow();
+    engine.start(leftSteps, rightSteps);
+    engine.runUntilIdle();
+    return (engine.virtualNow() - start) / 1e6f;
+}
+
+static float arc(double radius, double angle)
+{
+    long left, right;
+    calculateArcSteps(radius, angle, &left, &right);
+    return drive(left, right, arcSpeed(radius), MOVE_ACCEL, MOVE_JERK);
+}
+
+static float move(long distance)
+{
+    long steps = lround(distance * STEPS_PER_MM);
+    return drive(steps, -steps, MOVE_SPEED, MOVE_ACCEL, MOVE_JERK);
+}
+
+static float turn(double angle)
+{
+    long steps = calculateTurnSteps(angle);
+    return drive(-steps, -steps, TURN_SPEED, TURN_ACCEL, 0);
+}
+
+void setUp()
+{
+    pose = Pose();
+    engine.setPulseHook(onPulse, &pose);
+}
+
+void tearDown() {}
+
+void test_arcs_end_at_their_pose()
+{
+    const double arcs[][2] = {{200, 90}, {200, -90}, {500, 45}, {300, 180}, {1000, -30}, {100, 360}};
+    for (const double *a : arcs)
+    {
+        pose = Pose();
+        arc(a[0], a[1]);
+        double radians = a[1] * M_PI / 180;
+        double side = a[1] > 0 ? 1 : -1;
+        TEST_ASSERT_FLOAT_WITHIN(0.5f, a[0] * sin(fabs(radians)), pose.x);
+        TEST_ASSERT_FLOAT_WITHIN(0.5f, side * a[0] * (1 - cos(radians)), pose.y);
+        TEST_ASSERT_FLOAT_WITHIN(0.1f, a[1], pose.heading);
+    }
+}
+
+void test_arc_of_no_radius_turns_on_the_spot()
+{
+    long left, right;
+    calculateArcSteps(0, 90, &left, &right);
+    TEST_ASSERT_EQUAL(-calculateTurnSteps(90), left);
+    TEST_ASSERT_EQUAL(-calculateTurnSteps(90), right);
+    arc(0, 90);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0, pose.x);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 90, pose.heading);
+}
+
+// The chain has to stop twice more, once before and once after the turn
+void test_arc_is_faster_than_move_turn_move()
+{
+    const double radii[] = {100, 200, 500, 1000};
+    for (double radius : radii)
+    {
+        pose = Pose();
+        float chain = move(radius) + turn(90) + move(radius) + 2 * MIN_STOP_TIME / 1000.0f;
+        Pose chainPose = pose;
+        pose = Pose();
+        float curve = arc(radius, 90);
+        printf("radius %4.0f: arc %.2f s, f(%.0f).r().f(%.0f) %.2f s, saved %.2f s\n",
+               radius, curve, radius, radius, chain, chain - curve);
+        TEST_ASSERT_FLOAT_WITHIN(0.5f, chainPose.x, pose.x);
+        TEST_ASSERT_FLOAT_WITHIN(0.5f, chainPose.y, pose.y);
+        TEST_ASSERT_FLOAT_WITHIN(0.1f, chainPose.heading, pose.heading);
+        TEST_ASSERT_LESS_THAN(chain, curve);
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_arcs_end_at_their_pose);
+    RUN_TEST(test_arc_of_no_radius_turns_on_the_spot);
+    RUN_TEST(test_arc_is_faster_than_move_turn_move);
+    return UNITY_END();
+}
@@ -0,0 +1,186 @@
+// Benchmark of building and dispatching a command sequence: the bytecode of
+// CommandSequence against the vector of named commands it replaced, for the example run.
+// The run's sequence itself is constexpr, so on the robot its build cost is zero.
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "Commands.h"
+
+#define REPEATS 20000
+
+// The sequence as it was built before, a heap allocated command with a String name each
+struct NamedCommand
+{
+    std::string action;
+    double value;
+    double radius;
+};
+
+class NamedSequence
+{
+private:
+    std::vector<NamedCommand> commands;
+
+public:
+    NamedSequence &move(long distance = 500)
+    {
+        commands.push_back({"move", static_cast<double>(distance), 0});
+        return *this;
+    }
+
+    NamedSequence &turn(double degrees = 90)
+    {
+        commands.push_back({"turn", degrees, 0});
+        return *this;
+    }
+
+    NamedSequence &l(double degrees = 90) { return turn(-degrees); }
+    NamedSequence &r(double degrees = 90) { return turn(degrees); }
+    NamedSequence &f(long distance = 500) { return move(distance); }
+    NamedSequence &b(long distance = 500) { return move(-distance); }
+
+    const std::vector<NamedCommand> &getCommands() const { return commands; }
+};
+
+// The example run, written out for either builder
+template <typename Sequence>
+constexpr void buildRun(Sequence &sequence)
+{
+    sequence.f(250 + 42 + 500 + 300).b(300 + 500).r().f(1000).l().f().r().f().l().f(1000 + 300)
+        .b(300 + 500).l().f().r().f(1000).l().f(500 + 300).b(300 + 500).l().f(1000).r().f().l()
+        .f(1000).l().f(500 + 300).b(300 + 500).l().f(1500).l().f(500 - 42);
+}
+
+static constexpr CommandSequence runSequence = []()
+{
+    CommandSequence sequence;
+    buildRun(sequence);
+    return sequence;
+}();
+
+// Built by the compiler: 18 moves and 13 turns of 3 bytes each
+static_assert(runSequence.size() == 31 && runSequence.length() == 93 && runSequence.valid(),
+              "the example run compiles to bytecode");
+
+static volatile double sink;
+
+static double nowNs()
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// What the dispatch hands on to the robot, so both sides do the same work
+struct Totals
+{
+    double distance;
+    double angle;
+    size_t count;
+};
+
+static Totals dispatchNamed(const NamedSequence &sequence)
+{
+    Totals totals = {};
+    for (const NamedCommand &command : sequence.getCommands())
+    {
+        if (command.action == "move")
+            totals.distance += command.value;
+        else if (command.action == "turn")
+            totals.angle += command.value;
+        else if (command.action == "stop" || command.action == "arc" || command.action == "pivot")
+            totals.angle += command.radius;
+        totals.count++;
+    }
+    return totals;
+}
+
+static Totals dispatchBytecode(const CommandSequence &sequence)
+{
+    Totals totals = {};
+    CommandReader reader(sequence);
+    Command command;
+    while (reader.next(&command))
+    {
+        switch (command.op)
+        {
+        case OP_MOVE:
+            totals.distance += command.value;
+            break;
+        case OP_TURN:
+            totals.angle += command.value;
+            break;
+        case OP_STOP:
+        case OP_ARC:
+        case OP_PIVOT:
+            totals.angle += command.radius;
+            break;
+        }
+        totals.count++;
+    }
+    return totals;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_build()
+{
+    double start = nowNs();
+    for (int i = 0; i < REPEATS; i++)
+    {
+        NamedSequence sequence;
+        buildRun(sequence);
+        sink = sequence.getCommands().back().value;
+    }
+    double namedTime = (nowNs() - start) / REPEATS;
+
+    start = nowNs();
+    for (int i = 0; i < REPEATS; i++)
+    {
+        CommandSequence sequence;
+        buildRun(sequence);
+        sink = sequence.code()[sequence.length() - 1];
+    }
+    double bytecodeTime = (nowNs() - start) / REPEATS;
+
+    printf("build at run time: named %.0f ns, bytecode %.0f ns, %u commands\n",
+           namedTime, bytecodeTime, (unsigned)runSequence.size());
+    printf("size: named %u bytes on the heap, bytecode %u bytes\n",
+           (unsigned)(runSequence.size() * sizeof(NamedCommand)), (unsigned)runSequence.length());
+    TEST_ASSERT_LESS_THAN(namedTime, bytecodeTime);
+}
+
+void test_dispatch()
+{
+    NamedSequence named;
+    buildRun(named);
+
+    Totals expected = dispatchNamed(named);
+    Totals decoded = dispatchBytecode(runSequence);
+    TEST_ASSERT_EQUAL_UINT32(expected.count, decoded.count);
+    TEST_ASSERT_EQUAL_FLOAT(expected.distance, decoded.distance);
+    TEST_ASSERT_EQUAL_FLOAT(expected.angle, decoded.angle);
+
+    double start = nowNs();
+    for (int i = 0; i < REPEATS; i++)
+        sink = dispatchNamed(named).distance;
+    double namedTime = (nowNs() - start) / REPEATS / expected.count;
+
+    start = nowNs();
+    for (int i = 0; i < REPEATS; i++)
+        sink = dispatchBytecode(runSequence).distance;
+    double bytecodeTime = (nowNs() - start) / REPEATS / decoded.count;
+
+    printf("dispatch: named %.1f ns/command, bytecode %.1f ns/command\n", namedTime, bytecodeTime);
+    TEST_ASSERT_LESS_THAN(namedTime, bytecodeTime);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_build);
+    RUN_TEST(test_dispatch);
+    return UNITY_END();
+}
@@ -0,0 +1,93 @@
+// Benchmark of the move times with the trapezoid and the S-curve ramp, run on the
+// step engine's virtual timer for the moves of the example competition run.
+#include <unity.h>
+#include <stdio.h>
+#include "StepEngine.h"
+#include "MotionTiming.h"
+
+// Limits of the moves before the S-curve, the default MOVE_* must not be slower
+#define SPEED 6400.0f
+#define ACCEL 9600.0f
+#define JERK (ACCEL * 8.0f)
+
+// Faster limits the S-curve is meant to allow without wheel slip
+#define FAST_SPEED 9600.0f
+#define FAST_ACCEL 19200.0f
+#define FAST_JERK (FAST_ACCEL * 8.0f)
+
+// Moves of the example run, mm
+static const long runMoves[] = {1092, 800, 1000, 500, 500, 1300, 800, 500, 1000, 800,
+                                800, 1000, 500, 1000, 800, 800, 1500, 458};
+#define RUN_MOVES (sizeof(runMoves) / sizeof(runMoves[0]))
+
+static StepEngine engine;
+static uint64_t lastPulse;
+
+static void onPulse(uint8_t mask, uint64_t timeUs, void *context)
+{
+    (void)mask;
+    (void)context;
+    lastPulse = timeUs;
+}
+
+// Time of a move from its start to the last pulse, s
+static float moveTime(long mm)
+{
+    uint64_t start = engine.virtualNow();
+    engine.start(mm * STEPS_PER_MM, mm * STEPS_PER_MM);
+    engine.runUntilIdle();
+    return (lastPulse - start) / 1e6f;
+}
+
+// Total time of the run's moves with the given limits, each move printed
+static float runTime(const char *name, float speed, float accel, float jerk)
+{
+    engine.configure(speed, accel, jerk);
+    float total = 0;
+    printf("%-24s", name);
+    for (size_t i = 0; i < RUN_MOVES; i++)
+    {
+        float time = moveTime(runMoves[i]);
+        printf(" %5.2f", time);
+        total += time;
+    }
+    printf("  total %.2f s\n", total);
+    return total;
+}
+
+void setUp()
+{
+    engine.setPulseHook(onPulse, nullptr);
+}
+
+void tearDown() {}
+
+void test_move_times()
+{
+    printf("%-24s", "move mm");
+    for (size_t i = 0; i < RUN_MOVES; i++)
+        printf(" %5ld", runMoves[i]);
+    printf("\n");
+
+    float trapezoid = runTime("trapezoid", SPEED, ACCEL, 0);
+    float sCurve = runTime("S-curve", SPEED, ACCEL, JERK);
+    float fastTrapezoid = runTime("trapezoid, fast limits", FAST_SPEED, FAST_ACCEL, 0);
+    float fastSCurve = runTime("S-curve, fast limits", FAST_SPEED, FAST_ACCEL, FAST_JERK);
+    float configured = runTime("MOVE_* in MotionTiming.h", MOVE_SPEED, MOVE_ACCEL, MOVE_JERK);
+    printf("S-curve %+.2f s at the same limits, %+.2f s at the fast limits\n",
+           sCurve - trapezoid, fastSCurve - trapezoid);
+
+    // At the same limits the jerk limit costs time, the gain comes from raising them
+    TEST_ASSERT_GREATER_THAN(trapezoid, sCurve);
+    TEST_ASSERT_GREATER_THAN(fastTrapezoid, fastSCurve);
+    TEST_ASSERT_LESS_THAN(trapezoid, fastSCurve);
+    // The default limits never make a run slower than the trapezoid it replaced
+    TEST_ASSERT_TRUE(configured <= trapezoid);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_move_times);
+    return UNITY_END();
+}
@@ -0,0 +1,64 @@
+// Benchmark of the serial sequence parser on the example run, typed as one line.
+// The parser runs on every byte as it arrives, it must keep far ahead of the serial port.
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include "SequenceParser.h"
+
+// Set in src/config.cpp on the robot
+const double WHEEL_DISTANCE = 155.8; // mm
+
+#define REPEATS 20000
+// Bytes per second of the serial monitor at 115200 baud
+#define SERIAL_RATE (115200 / 10)
+
+static const char *runLine =
+    "f1092 b800 r f1000 l f r f l f1300 b800 l f r f1000 l f800 b800 l f1000 r f l f1000 l f800 b800 l f1500 l f458\n";
+
+static volatile size_t sink;
+
+static double nowNs()
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_parse_throughput()
+{
+    static SequenceParser parser;
+    size_t length = strlen(runLine);
+    size_t commands = 0;
+
+    double start = nowNs();
+    for (int i = 0; i < REPEATS; i++)
+    {
+        parser.reset();
+        SequenceParser::Result result = SequenceParser::PARSE_MORE;
+        for (size_t c = 0; c < length && result == SequenceParser::PARSE_MORE; c++)
+            result = parser.feed(runLine[c]);
+        TEST_ASSERT_EQUAL(SequenceParser::PARSE_DONE, result);
+        commands = parser.sequence().size();
+        sink = parser.sequence().length();
+    }
+    double perLine = (nowNs() - start) / REPEATS;
+
+    double bytesPerSecond = length * 1e9 / perLine;
+    printf("parsed %u bytes, %u commands: %.0f ns/line, %.1f ns/byte, %.1f MB/s, %.0fx the serial rate\n",
+           (unsigned)length, (unsigned)commands, perLine, perLine / length, bytesPerSecond / 1e6,
+           bytesPerSecond / SERIAL_RATE);
+
+    TEST_ASSERT_EQUAL_UINT32(31, commands);
+    // On the ESP32 the parser is some ten times slower than here, that must still be ahead
+    TEST_ASSERT_GREATER_THAN(100 * SERIAL_RATE, bytesPerSecond);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_throughput);
+    return UNITY_END();
+}
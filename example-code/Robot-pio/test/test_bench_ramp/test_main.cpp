@@ -0,0 +1,177 @@
+// Benchmark of the per-step cost of the step timing: AccelStepper's computeNewSpeed,
+// which the robot ran for every step before, against the scheduler's table lookups
+// from a ramp planned in the RampArena.
+// On the ESP32 doubles are done in software, so the gap there is much wider than on a PC.
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+#include "RampArena.h"
+
+#define STEPS_PER_MM 16
+#define SPEED 6400.0f
+#define ACCEL 9600.0f
+#define JERK (ACCEL * 8.0f)
+#define TURN_SPEED 3200.0f
+#define TURN_ACCEL 6400.0f
+
+// Moves of the example run, mm
+static const long runMoves[] = {1092, 800, 1000, 500, 500, 1300, 800, 500, 1000, 800,
+                                800, 1000, 500, 1000, 800, 800, 1500, 458};
+#define RUN_MOVES (sizeof(runMoves) / sizeof(runMoves[0]))
+#define REPEATS 20
+
+// AccelStepper::computeNewSpeed for a move forward from standstill, as it ran for every step
+class AccelStepperRamp
+{
+private:
+    long _target;
+    long _position = 0;
+    long _n = 0;
+    double _speed = 0;
+    double _acceleration;
+    double _c0;
+    double _cn = 0;
+    double _cmin;
+
+public:
+    AccelStepperRamp(long steps, double speed, double acceleration)
+        : _target(steps), _acceleration(acceleration)
+    {
+        _c0 = 0.676 * sqrt(2.0 / acceleration) * 1000000.0;
+        _cmin = 1000000.0 / speed;
+    }
+
+    // Interval before the next step in us, 0 when the move is done
+    unsigned long next()
+    {
+        long distanceTo = _target - _position;
+        long stepsToStop = (long)((_speed * _speed) / (2.0 * _acceleration));
+        if (distanceTo == 0 && stepsToStop <= 1)
+            return 0;
+        if (distanceTo > 0 && _n > 0 && stepsToStop >= distanceTo)
+            _n = -stepsToStop;
+        if (_n == 0)
+        {
+            _cn = _c0;
+        }
+        else
+        {
+            _cn = _cn - ((2.0 * _cn) / ((4.0 * _n) + 1));
+            _cn = _cn > _cmin ? _cn : _cmin;
+        }
+        _n++;
+        _speed = 1000000.0 / _cn;
+        _position++;
+        return (unsigned long)_cn;
+    }
+};
+
+static RampArena arena;
+static StepScheduler scheduler;
+
+static double nowNs()
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void setUp()
+{
+    arena.clear();
+}
+
+void tearDown() {}
+
+void test_step_cost()
+{
+    uint64_t steps = 0;
+    uint64_t accelStepperTime = 0;
+    double start = nowNs();
+    for (int r = 0; r < REPEATS; r++)
+    {
+        for (size_t i = 0; i < RUN_MOVES; i++)
+        {
+            AccelStepperRamp ramp(runMoves[i] * STEPS_PER_MM, SPEED, ACCEL);
+            while (unsigned long interval = ramp.next())
+            {
+                accelStepperTime += interval;
+                steps++;
+            }
+        }
+    }
+    double accelStepperNs = (nowNs() - start) / steps;
+
+    // The tables are built once when the sequence is loaded
+    StepProfile profiles[RUN_MOVES];
+    start = nowNs();
+    for (size_t i = 0; i < RUN_MOVES; i++)
+        TEST_ASSERT_TRUE(arena.plan(runMoves[i] * STEPS_PER_MM, SPEED, ACCEL, 0, &profiles[i]));
+    double planUs = (nowNs() - start) / 1000;
+
+    uint64_t ticks = 0;
+    uint64_t tableTime = 0;
+    start = nowNs();
+    for (int r = 0; r < REPEATS; r++)
+    {
+        for (size_t i = 0; i < RUN_MOVES; i++)
+        {
+            const long wheels[STEP_CHANNELS] = {runMoves[i] * STEPS_PER_MM, runMoves[i] * STEPS_PER_MM};
+            scheduler.load(profiles[i], wheels);
+            uint32_t delay = scheduler.start();
+            while (delay)
+            {
+                tableTime += delay;
+                if (scheduler.tick(&delay))
+                    ticks++;
+            }
+        }
+    }
+    double tableNs = (nowNs() - start) / ticks;
+
+    printf("computeNewSpeed %.1f ns/step, table lookup %.1f ns/step, %lu steps\n",
+           accelStepperNs, tableNs, (unsigned long)steps);
+    printf("planned %u moves into %u tables of %u entries in %.0f us\n",
+           (unsigned)RUN_MOVES, arena.count(), (unsigned)arena.used(), planUs);
+
+    // Same steps, and the tables use the same recurrence so the run takes as long
+    TEST_ASSERT_EQUAL_UINT32(steps, ticks);
+    TEST_ASSERT_EQUAL(1, arena.count());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f * accelStepperTime, (float)accelStepperTime, (float)tableTime);
+}
+
+// What a command costs when the arena is full and its ramp is built when it runs
+void test_run_time_ramp_cost()
+{
+    static uint16_t ramp[RAMP_ARENA_SIZE];
+    uint32_t cruise;
+    const int builds = 100;
+
+    double start = nowNs();
+    uint32_t entries = 0;
+    for (int i = 0; i < builds; i++)
+        entries += buildStepRamp(SPEED, ACCEL, ramp, RAMP_ARENA_SIZE, &cruise);
+    double trapezoidUs = (nowNs() - start) / builds / 1000;
+
+    start = nowNs();
+    for (int i = 0; i < builds; i++)
+        entries += buildSCurveRamp(SPEED, ACCEL, JERK, ramp, RAMP_ARENA_SIZE, &cruise);
+    double sCurveUs = (nowNs() - start) / builds / 1000;
+
+    start = nowNs();
+    StepProfile profile;
+    for (int i = 0; i < builds; i++)
+        TEST_ASSERT_TRUE(arena.plan(8000, TURN_SPEED, TURN_ACCEL, 0, &profile));
+    double sharedUs = (nowNs() - start) / builds / 1000;
+
+    printf("ramp build: trapezoid %.1f us, S-curve %.1f us, shared arena table %.3f us\n",
+           trapezoidUs, sCurveUs, sharedUs);
+    TEST_ASSERT_GREATER_THAN(0, entries);
+    TEST_ASSERT_EQUAL(1, arena.count());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_step_cost);
+    RUN_TEST(test_run_time_ramp_cost);
+    return UNITY_END();
+}
@@ -0,0 +1,176 @@
+// Host simulation of a target time run: the example run with IMU turns that take a
+// random time, started at deadlines (planStartTimes) re-planned after every segment as
+// Travel does, or after fixed stops. With deadlines a slow or quick turn is absorbed by
+// the stops after it, so the spread of the final time is that of the last command, not
+// of the whole run.
+#include <unity.h>
+#include <stdio.h>
+#include <math.h>
+#include <random>
+#include "Timeline.h"
+#include "MotionTiming.h"
+
+// Set in src/config.cpp on the robot
+const double WHEEL_DISTANCE = 155.8; // mm
+
+#define RUNS 2000
+#define STOP_TIME 10000 // ms
+// Spread of an IMU turn's time around its expected time, ms
+#define TURN_SIGMA 60.0
+#define MOVE_SIGMA 5.0
+
+// The example run, mm for moves, 0 for a 90 degree turn
+static const long runSegments[] = {1092, -800, 0, 1000, 0, 500, 0, 500, 0, 1300, -800, 0, 500, 0, 1000, 0,
+                                   800, -800, 0, 1000, 0, 500, 0, 1000, 0, 800, -800, 0, 1500, 0, 458};
+#define RUN_SEGMENTS (sizeof(runSegments) / sizeof(runSegments[0]))
+
+struct Spread
+{
+    double mean; // error of the final time from the target, ms
+    double std;  // ms
+    double late; // segments started late per run
+};
+
+static std::vector<size_t> counts;
+static std::vector<unsigned long> expected;
+static unsigned long targetTime;
+
+static Spread spread(const std::vector<double> &errors, size_t late)
+{
+    double sum = 0, squares = 0;
+    for (double error : errors)
+    {
+        sum += error;
+        squares += error * error;
+    }
+    double mean = sum / errors.size();
+    return {mean, sqrt(squares / errors.size() - mean * mean), (double)late / errors.size()};
+}
+
+// Final time error of runs started at deadlines and runs with fixed stops, same random times
+static void simulate(Spread *deadlines, Spread *stops)
+{
+    std::mt19937 random(42);
+    std::normal_distribution<double> turnNoise(0, TURN_SIGMA);
+    std::normal_distribution<double> moveNoise(0, MOVE_SIGMA);
+    double stopTime = (double)STOP_TIME / (RUN_SEGMENTS - 1);
+
+    std::vector<double> deadlineErrors, stopErrors;
+    size_t late = 0;
+    for (int run = 0; run < RUNS; run++)
+    {
+        std::vector<int64_t> starts = planStartTimes(counts, expected, targetTime);
+        double atDeadlines = 0, withStops = 0;
+        for (size_t s = 0; s < RUN_SEGMENTS; s++)
+        {
+            double actual = expected[s] + (runSegments[s] ? moveNoise(random) : turnNoise(random));
+            double start = starts[s] / 1000.0;
+            if (atDeadlines > start)
+                late++;
+            atDeadlines = (atDeadlines > start ? atDeadlines : start) + actual;
+            withStops += actual + (s < RUN_SEGMENTS - 1 ? stopTime : 0);
+            starts = planStartTimes(counts, expected, targetTime, s + 1, lround(atDeadlines * 1000));
+        }
+        deadlineErrors.push_back(atDeadlines - targetTime);
+        stopErrors.push_back(withStops - targetTime);
+    }
+    *deadlines = spread(deadlineErrors, late);
+    *stops = spread(stopErrors, 0);
+}
+
+void setUp()
+{
+    counts.assign(RUN_SEGMENTS, 1);
+    expected.clear();
+    unsigned long expectedTotal = 0;
+    for (size_t s = 0; s < RUN_SEGMENTS; s++)
+    {
+        // IMU turns take longer than their step profile
+        expected.push_back(runSegments[s] ? estimateMoveTime(runSegments[s]) : estimateTurnTime(90) + 150);
+        expectedTotal += expected.back();
+    }
+    targetTime = expectedTotal + STOP_TIME;
+}
+
+void tearDown() {}
+
+void test_start_times_fill_the_target()
+{
+    std::vector<int64_t> starts = planStartTimes(counts, expected, targetTime);
+    TEST_ASSERT_EQUAL_INT32(0, (int32_t)starts[0]);
+    for (size_t s = 1; s < RUN_SEGMENTS; s++)
+        TEST_ASSERT_TRUE(starts[s] >= starts[s - 1] + (int64_t)expected[s - 1] * 1000);
+    // The last command ends on the target, to within the rounding of the stops
+    int64_t end = starts.back() + (int64_t)expected.back() * 1000;
+    TEST_ASSERT_INT_WITHIN((int)RUN_SEGMENTS, (int)targetTime, (int)(end / 1000));
+}
+
+// A blended run of moves takes the stops of all its commands
+void test_blended_segment_keeps_its_stops()
+{
+    std::vector<size_t> blended = {1, 3, 1};
+    std::vector<unsigned long> times = {1000, 2000, 1000};
+    std::vector<int64_t> starts = planStartTimes(blended, times, 4000 + 400);
+    TEST_ASSERT_EQUAL_INT32(1100000, (int32_t)starts[1]);
+    TEST_ASSERT_EQUAL_INT32(3400000, (int32_t)starts[2]);
+
+    // At the end of the sequence its share goes before it
+    std::vector<size_t> ending = {1, 3};
+    std::vector<unsigned long> endingTimes = {1000, 2000};
+    starts = planStartTimes(ending, endingTimes, 3000 + 300);
+    TEST_ASSERT_EQUAL_INT32(1300000, (int32_t)starts[1]);
+}
+
+// A segment that ran long takes its overrun out of all the stops still to come,
+// the run still ends on the target
+void test_overrun_is_spread_over_the_stops_left()
+{
+    std::vector<size_t> segments = {1, 1, 1, 1, 1};
+    std::vector<unsigned long> times = {1000, 1000, 1000, 1000, 1000};
+    std::vector<int64_t> starts = planStartTimes(segments, times, 5000 + 800);
+    TEST_ASSERT_EQUAL_INT32(1200000, (int32_t)starts[1]);
+
+    // The first segment ran 400 ms long: 800 - 400 ms over the 4 stops left
+    starts = planStartTimes(segments, times, 5800, 1, 1400000);
+    TEST_ASSERT_EQUAL_INT32(0, (int32_t)starts[0]);
+    TEST_ASSERT_EQUAL_INT32(1500000, (int32_t)starts[1]);
+    TEST_ASSERT_EQUAL_INT32(2600000, (int32_t)starts[2]);
+    TEST_ASSERT_EQUAL_INT32(4800000, (int32_t)starts[4]);
+
+    // Past the target there is no stop left, every segment starts when the last one ends
+    starts = planStartTimes(segments, times, 5800, 3, 3900000);
+    TEST_ASSERT_EQUAL_INT32(3900000, (int32_t)starts[3]);
+    TEST_ASSERT_EQUAL_INT32(4900000, (int32_t)starts[4]);
+
+    // A blended run before the re-plan takes the stops of all its commands
+    std::vector<size_t> blended = {3, 1, 1};
+    std::vector<unsigned long> blendedTimes = {2000, 1000, 1000};
+    starts = planStartTimes(blended, blendedTimes, 4000 + 400, 1, 2000000);
+    TEST_ASSERT_EQUAL_INT32(2300000, (int32_t)starts[1]);
+    TEST_ASSERT_EQUAL_INT32(3400000, (int32_t)starts[2]);
+}
+
+void test_deadlines_reduce_final_time_spread()
+{
+    Spread deadlines, stops;
+    simulate(&deadlines, &stops);
+    printf("target %lu ms, turn sigma %.0f ms\n", targetTime, TURN_SIGMA);
+    printf("fixed stops: final time error %+.1f ms, std %.1f ms\n", stops.mean, stops.std);
+    printf("deadlines:   final time error %+.1f ms, std %.1f ms, %.2f segments late per run\n",
+           deadlines.mean, deadlines.std, deadlines.late);
+
+    // Fixed stops add up the spread of every turn, deadlines keep that of the last move
+    TEST_ASSERT_LESS_THAN(stops.std / 5, deadlines.std);
+    TEST_ASSERT_LESS_THAN(2 * MOVE_SIGMA, deadlines.std);
+    TEST_ASSERT_FLOAT_WITHIN(MOVE_SIGMA, 0, deadlines.mean);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_start_times_fill_the_target);
+    RUN_TEST(test_blended_segment_keeps_its_stops);
+    RUN_TEST(test_overrun_is_spread_over_the_stops_left);
+    RUN_TEST(test_deadlines_reduce_final_time_spread);
+    return UNITY_END();
+}
@@ -0,0 +1,179 @@
+// Heading hold against a simulated drifting robot: the right wheel slips, so equal
+// steps turn the robot. The step engine runs on its virtual timer, the yaw is
+// integrated from the wheel distances and read back late, as from the IMU.
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include "StepEngine.h"
+#include "HeadingHold.h"
+
+#define STEPS_PER_MM 16.0f
+#define WHEEL_DISTANCE 155.8f // mm
+#define SPEED 6400.0f
+#define ACCEL 9600.0f
+#define JERK (ACCEL * 8.0f)
+
+// Robot.h heading hold settings
+#define KP 0.05f
+#define KI 0.1f
+#define MAX_TRIM 0.1f
+#define PERIOD_US 10000
+
+// Age of the yaw when it is read, in hold periods
+#define IMU_DELAY_PERIODS 2
+#define MOVE_MM 2000
+#define MOVE_STEPS ((long)(MOVE_MM * STEPS_PER_MM))
+
+struct Robot
+{
+    float slip[STEP_CHANNELS]; // fraction of each step lost to the floor
+    double distance[STEP_CHANNELS];
+    double yaw; // degrees, positive to the left
+    double lateral; // mm to the left of the straight line
+};
+
+static StepEngine engine;
+static Robot robot;
+
+static void onPulse(uint8_t mask, uint64_t timeUs, void *context)
+{
+    (void)timeUs;
+    Robot &r = *(Robot *)context;
+    double step[STEP_CHANNELS] = {0, 0};
+    for (uint8_t i = 0; i < STEP_CHANNELS; i++)
+    {
+        if (mask & (1 << i))
+            step[i] = (1 - r.slip[i]) / STEPS_PER_MM;
+        r.distance[i] += step[i];
+    }
+    r.yaw += (step[STEP_RIGHT] - step[STEP_LEFT]) / WHEEL_DISTANCE * 180 / M_PI;
+    r.lateral += (step[STEP_LEFT] + step[STEP_RIGHT]) / 2 * sin(r.yaw * M_PI / 180);
+}
+
+// Drive a straight move, with or without heading hold
+static void drive(long steps, float rightSlip, bool hold)
+{
+    robot = Robot();
+    robot.slip[STEP_RIGHT] = rightSlip;
+    HeadingHold heading(KP, KI, MAX_TRIM, PERIOD_US / 1e6f);
+    double readings[IMU_DELAY_PERIODS + 1] = {};
+
+    engine.start(steps, steps);
+    for (int period = 0; engine.isRunning(); period++)
+    {
+        readings[period % (IMU_DELAY_PERIODS + 1)] = robot.yaw;
+        if (hold && period >= IMU_DELAY_PERIODS)
+        {
+            float leftTrim, rightTrim;
+            heading.update(readings[(period - IMU_DELAY_PERIODS) % (IMU_DELAY_PERIODS + 1)], 0, false,
+                           &leftTrim, &rightTrim);
+            engine.setTrim(leftTrim, rightTrim);
+        }
+        engine.advance(PERIOD_US);
+    }
+    printf("slip %.1f%% hold %d: yaw %.2f deg, lateral %.1f mm, wheels %.1f / %.1f mm, max error %.2f\n",
+           rightSlip * 100, hold, robot.yaw, robot.lateral, robot.distance[STEP_LEFT], robot.distance[STEP_RIGHT],
+           heading.maxError());
+}
+
+void setUp()
+{
+    engine.setPulseHook(onPulse, &robot);
+    engine.configure(SPEED, ACCEL, JERK);
+}
+
+void tearDown() {}
+
+void test_robot_drifts_without_hold()
+{
+    drive(MOVE_STEPS, 0.02f, false);
+    // 2% of 2 m over the wheel base
+    TEST_ASSERT_FLOAT_WITHIN(0.2f, -0.02f * MOVE_MM / WHEEL_DISTANCE * 180 / M_PI, robot.yaw);
+    TEST_ASSERT_LESS_THAN(-100, robot.lateral);
+}
+
+void test_hold_keeps_heading_and_line()
+{
+    const float slips[] = {0.005f, 0.02f, 0.05f};
+    for (float slip : slips)
+    {
+        drive(MOVE_STEPS, slip, true);
+        TEST_ASSERT_FLOAT_WITHIN(0.5f, 0, robot.yaw);
+        TEST_ASSERT_FLOAT_WITHIN(10, 0, robot.lateral);
+    }
+}
+
+void test_hold_steers_both_ways()
+{
+    drive(MOVE_STEPS, -0.02f, true);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 0, robot.yaw);
+    TEST_ASSERT_FLOAT_WITHIN(10, 0, robot.lateral);
+}
+
+// The trimmed wheel's lost steps are shared out, so the move still covers its distance
+void test_hold_keeps_the_distance()
+{
+    drive(MOVE_STEPS, 0.02f, true);
+    long left = engine.position(STEP_LEFT);
+    long right = engine.position(STEP_RIGHT);
+    TEST_ASSERT_GREATER_THAN(left, right);
+    TEST_ASSERT_INT_WITHIN(1, 2 * MOVE_STEPS, left + right);
+}
+
+struct Gaps
+{
+    uint64_t lastPulse;
+    uint32_t lastGap;
+    int faster; // gaps shorter than the one before
+};
+
+// Gaps between the pulses of the untrimmed right wheel, which steps on every tick
+static void onRightPulse(uint8_t mask, uint64_t timeUs, void *context)
+{
+    Gaps &g = *(Gaps *)context;
+    if (!(mask & (1 << STEP_RIGHT)))
+        return;
+    if (g.lastPulse)
+    {
+        uint32_t gap = (uint32_t)(timeUs - g.lastPulse);
+        if (g.lastGap && gap + 1 < g.lastGap)
+            g.faster++;
+        g.lastGap = gap;
+    }
+    g.lastPulse = timeUs;
+}
+
+// Trim changing while the move slows down lengthens it, the wheels must not speed back up
+void test_trim_during_deceleration_keeps_slowing()
+{
+    const float jerks[] = {0, JERK};
+    for (float jerk : jerks)
+    {
+        Gaps gaps = {};
+        engine.configure(SPEED, ACCEL, jerk);
+        engine.start(MOVE_STEPS, MOVE_STEPS);
+        while (engine.progress() < 0.97f)
+            engine.advance(PERIOD_US);
+        TEST_ASSERT_LESS_THAN(SPEED * 0.9f, engine.speed(STEP_RIGHT));
+        engine.setPulseHook(onRightPulse, &gaps);
+        for (int period = 0; engine.isRunning(); period++)
+        {
+            engine.setTrim(period % 3 ? 1 - MAX_TRIM : 1, 1);
+            engine.advance(PERIOD_US);
+        }
+        engine.setPulseHook(nullptr, nullptr);
+        TEST_ASSERT_EQUAL(0, gaps.faster);
+        TEST_ASSERT_INT_WITHIN(2, 2 * MOVE_STEPS, engine.position(STEP_LEFT) + engine.position(STEP_RIGHT));
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_robot_drifts_without_hold);
+    RUN_TEST(test_hold_keeps_heading_and_line);
+    RUN_TEST(test_hold_steers_both_ways);
+    RUN_TEST(test_hold_keeps_the_distance);
+    RUN_TEST(test_trim_during_deceleration_keeps_slowing);
+    return UNITY_END();
+}
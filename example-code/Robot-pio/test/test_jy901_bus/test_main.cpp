@@ -0,0 +1,185 @@
+// Host tests of the JY901 reads over a mock I2C bus: a failed read, a sensor that
+// hangs past the timeout and a read started while one is busy must all recover.
+#include <unity.h>
+#include <chrono>
+#include <thread>
+#include "JY901.h"
+
+// Longer than FinishRead waits by default
+#define HANG_MS (JY901_TIMEOUT_MS * 6)
+
+static JY901MockBus bus;
+// The bus task keeps a pointer to its sensor, so the sensors outlive the tests
+static CJY901 sensor;
+static CJY901 unstarted;
+
+static void sleepMs(unsigned long ms)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+static void waitWhileBusy(CJY901 &jy)
+{
+	for (int i = 0; i < 1000 && jy.ReadState() == JY901_BUSY; i++)
+		sleepMs(1);
+}
+
+void setUp()
+{
+	bus.ulFailNext = 0;
+	bus.ulDelayMs = 0;
+	bus.setRegister(Yaw, 16384);
+	bus.setRegister(GZ, -1638);
+}
+
+void tearDown()
+{
+	// Leave no read on the bus for the next test
+	bus.ulDelayMs = 0;
+	waitWhileBusy(sensor);
+	if (sensor.ReadState() != JY901_IDLE)
+		sensor.FinishSample();
+}
+
+void test_blocking_reads_without_bus_task()
+{
+	unstarted.SetBus(&bus);
+	TEST_ASSERT_TRUE(unstarted.GetAngle());
+	TEST_ASSERT_EQUAL_INT16(16384, unstarted.stcAngle.Angle[2]);
+	TEST_ASSERT_FALSE(unstarted.StartSample());
+
+	bus.ulFailNext = 1;
+	unsigned long errors = unstarted.GetErrorCount();
+	TEST_ASSERT_FALSE(unstarted.GetGyro());
+	TEST_ASSERT_EQUAL_UINT32(errors + 1, unstarted.GetErrorCount());
+	TEST_ASSERT_TRUE(unstarted.GetGyro());
+	TEST_ASSERT_EQUAL_INT16(-1638, unstarted.stcGyro.w[2]);
+}
+
+void test_no_bus_fails_reads()
+{
+	static CJY901 noBus;
+	TEST_ASSERT_FALSE(noBus.GetAngle());
+	TEST_ASSERT_EQUAL_UINT32(1, noBus.GetErrorCount());
+}
+
+void test_asynchronous_sample()
+{
+	sensor.SetBus(&bus);
+	sensor.StartIIC();
+	TEST_ASSERT_EQUAL(JY901_IDLE, sensor.ReadState());
+	TEST_ASSERT_TRUE(sensor.StartSample());
+	TEST_ASSERT_TRUE(sensor.FinishSample());
+	TEST_ASSERT_EQUAL(JY901_IDLE, sensor.ReadState());
+	TEST_ASSERT_EQUAL_INT16(16384, sensor.stcSample.Angle[2]);
+	TEST_ASSERT_EQUAL_INT16(16384, sensor.stcAngle.Angle[2]);
+	TEST_ASSERT_EQUAL_INT16(-1638, sensor.stcGyro.w[2]);
+	TEST_ASSERT_TRUE(sensor.stcSample.ulMicros > 0);
+}
+
+// A read the sensor does not acknowledge comes back FAILED, the data is kept
+void test_failed_read_recovers()
+{
+	unsigned long errors = sensor.GetErrorCount();
+	bus.ulFailNext = 1;
+	bus.setRegister(Yaw, 100);
+	TEST_ASSERT_TRUE(sensor.StartSample());
+	waitWhileBusy(sensor);
+	TEST_ASSERT_EQUAL(JY901_FAILED, sensor.ReadState());
+	TEST_ASSERT_FALSE(sensor.FinishSample());
+	TEST_ASSERT_EQUAL(JY901_IDLE, sensor.ReadState());
+	TEST_ASSERT_EQUAL_INT16(16384, sensor.stcSample.Angle[2]);
+	TEST_ASSERT_EQUAL_UINT32(errors + 1, sensor.GetErrorCount());
+
+	TEST_ASSERT_TRUE(sensor.StartSample());
+	TEST_ASSERT_TRUE(sensor.FinishSample());
+	TEST_ASSERT_EQUAL_INT16(100, sensor.stcSample.Angle[2]);
+	TEST_ASSERT_EQUAL_UINT32(errors + 1, sensor.GetErrorCount());
+}
+
+// While a read is on the bus no other can start, a timed out one stays BUSY until
+// the bus is done with it, and is then collected
+void test_busy_and_timeout_recover()
+{
+	unsigned long errors = sensor.GetErrorCount();
+	bus.ulDelayMs = HANG_MS;
+	TEST_ASSERT_TRUE(sensor.StartSample());
+	TEST_ASSERT_EQUAL(JY901_BUSY, sensor.ReadState());
+	TEST_ASSERT_FALSE(sensor.StartSample());
+
+	auto start = std::chrono::steady_clock::now();
+	TEST_ASSERT_FALSE(sensor.FinishSample());
+	long waited = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	TEST_ASSERT_TRUE(waited < HANG_MS);
+	TEST_ASSERT_EQUAL(JY901_BUSY, sensor.ReadState());
+	TEST_ASSERT_EQUAL_UINT32(errors + 1, sensor.GetErrorCount());
+	TEST_ASSERT_FALSE(sensor.StartSample());
+
+	bus.ulDelayMs = 0;
+	waitWhileBusy(sensor);
+	TEST_ASSERT_EQUAL(JY901_DONE, sensor.ReadState());
+	TEST_ASSERT_TRUE(sensor.FinishSample());
+	TEST_ASSERT_EQUAL(JY901_IDLE, sensor.ReadState());
+	TEST_ASSERT_TRUE(sensor.StartSample());
+	TEST_ASSERT_TRUE(sensor.FinishSample());
+}
+
+// A blocking read gives up after its timeout, once the bus is free again the next one
+// drops the late read and reads anew
+void test_blocking_read_times_out()
+{
+	unsigned long reads = bus.ulReads;
+	bus.ulDelayMs = HANG_MS;
+	TEST_ASSERT_FALSE(sensor.GetAngle());
+	bus.ulDelayMs = 0;
+	bus.setRegister(Yaw, -200);
+	waitWhileBusy(sensor);
+	TEST_ASSERT_TRUE(sensor.GetAngle());
+	TEST_ASSERT_EQUAL_INT16(-200, sensor.stcAngle.Angle[2]);
+	TEST_ASSERT_EQUAL_UINT32(reads + 2, bus.ulReads);
+}
+
+// A read nobody finished leaves its done signal behind. The next read must not take it
+// for its own and return before its bytes are in.
+void test_left_over_signal_is_not_taken_for_the_next_read()
+{
+	TEST_ASSERT_TRUE(sensor.StartSample());
+	waitWhileBusy(sensor);
+	sleepMs(2); // the signal follows the state
+	bus.setRegister(Yaw, 1234);
+	bus.ulDelayMs = 20;
+	TEST_ASSERT_TRUE(sensor.StartSample());
+	TEST_ASSERT_TRUE(sensor.FinishSample(HANG_MS * 2));
+	TEST_ASSERT_EQUAL_INT16(1234, sensor.stcSample.Angle[2]);
+	TEST_ASSERT_EQUAL(JY901_IDLE, sensor.ReadState());
+}
+
+void test_write_waits_for_the_bus()
+{
+	unsigned long reads = bus.ulReads;
+	bus.ulDelayMs = HANG_MS;
+	TEST_ASSERT_TRUE(sensor.StartSample());
+	// The bus task holds the bus from before the read starts
+	while (bus.ulReads == reads)
+		sleepMs(1);
+	sensor.WriteWord(0x76, 0x00);
+	// The write went out after the read, which is done by now
+	TEST_ASSERT_EQUAL(JY901_DONE, sensor.ReadState());
+	TEST_ASSERT_EQUAL_INT16(0, bus.getRegister(0x76));
+	sensor.WriteWord(CALSW, 0x1234);
+	TEST_ASSERT_EQUAL_INT16(0x1234, bus.getRegister(CALSW));
+}
+
+int main()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_blocking_reads_without_bus_task);
+	RUN_TEST(test_no_bus_fails_reads);
+	RUN_TEST(test_asynchronous_sample);
+	RUN_TEST(test_failed_read_recovers);
+	RUN_TEST(test_busy_and_timeout_recover);
+	RUN_TEST(test_blocking_read_times_out);
+	RUN_TEST(test_left_over_signal_is_not_taken_for_the_next_read);
+	RUN_TEST(test_write_waits_for_the_bus);
+	return UNITY_END();
+}
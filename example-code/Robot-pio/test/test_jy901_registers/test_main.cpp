@@ -0,0 +1,130 @@
+// Host test of the burst read of registers AX to Yaw from a fake register map: the 24
+// bytes must decode into the right fields in one transaction, and scale to the units
+// the robot works in.
+#include <unity.h>
+#include <stddef.h>
+#include <math.h>
+#include "JY901.h"
+
+static JY901MockBus bus;
+static CJY901 sensor;
+static CJY901 pipelined;
+
+// A robot tilted a little and turning left at 250 degrees/s, after a quarter turn left
+static const double acceleration[3] = {0.25, -0.5, 1.0};  // g
+static const double rate[3] = {-1.5, 3.0, 250.0};          // degrees/s
+static const short magnet[3] = {-1234, 567, 32767};        // raw
+static const double angle[3] = {-2.5, 10.0, 90.0};        // degrees
+
+static short raw(double value, double scale)
+{
+	return (short)lround(value / scale);
+}
+
+static void fillRegisters()
+{
+	for (int i = 0; i < 3; i++)
+	{
+		bus.setRegister(AX + i, raw(acceleration[i], JY901_ACC_SCALE));
+		bus.setRegister(GX + i, raw(rate[i], JY901_RATE_SCALE));
+		bus.setRegister(HX + i, magnet[i]);
+		bus.setRegister(Roll + i, raw(angle[i], JY901_ANGLE_SCALE));
+	}
+	// Registers either side of the burst, must not be read into the sample
+	bus.setRegister(MS, 0x5555);
+	bus.setRegister(TEMP, 0x2222);
+}
+
+static void assertSample(CJY901 &jy)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		TEST_ASSERT_FLOAT_WITHIN(JY901_ACC_SCALE, acceleration[i], jy.stcSample.a[i] * JY901_ACC_SCALE);
+		TEST_ASSERT_FLOAT_WITHIN(JY901_RATE_SCALE, rate[i], jy.stcSample.w[i] * JY901_RATE_SCALE);
+		TEST_ASSERT_EQUAL_INT16(magnet[i], jy.stcSample.h[i]);
+		TEST_ASSERT_FLOAT_WITHIN(JY901_ANGLE_SCALE, angle[i], jy.stcSample.Angle[i] * JY901_ANGLE_SCALE);
+
+		// Copied to the structs of the separate reads
+		TEST_ASSERT_EQUAL_INT16(jy.stcSample.a[i], jy.stcAcc.a[i]);
+		TEST_ASSERT_EQUAL_INT16(jy.stcSample.w[i], jy.stcGyro.w[i]);
+		TEST_ASSERT_EQUAL_INT16(jy.stcSample.Angle[i], jy.stcAngle.Angle[i]);
+	}
+}
+
+void setUp()
+{
+	fillRegisters();
+}
+
+void tearDown() {}
+
+// The sample is the registers in order, nothing between them
+void test_sample_layout()
+{
+	TEST_ASSERT_EQUAL_UINT32(0, offsetof(SSample, a));
+	TEST_ASSERT_EQUAL_UINT32((GX - AX) * 2, offsetof(SSample, w));
+	TEST_ASSERT_EQUAL_UINT32((HX - AX) * 2, offsetof(SSample, h));
+	TEST_ASSERT_EQUAL_UINT32((Roll - AX) * 2, offsetof(SSample, Angle));
+	TEST_ASSERT_EQUAL_UINT32((Yaw - AX + 1) * 2, JY901_SAMPLE_BYTES);
+	TEST_ASSERT_TRUE(offsetof(SSample, ulMicros) >= JY901_SAMPLE_BYTES);
+}
+
+void test_burst_read_decodes_every_register()
+{
+	sensor.SetBus(&bus);
+	unsigned long reads = bus.ulReads;
+	TEST_ASSERT_TRUE(sensor.GetSample());
+	TEST_ASSERT_EQUAL_UINT32(reads + 1, bus.ulReads);
+	TEST_ASSERT_EQUAL_UINT8(AX, bus.ucLastReg);
+	TEST_ASSERT_EQUAL_UINT8(JY901_SAMPLE_BYTES, bus.ucLastLength);
+	assertSample(sensor);
+}
+
+void test_pipelined_read_decodes_every_register()
+{
+	pipelined.SetBus(&bus);
+	pipelined.StartIIC();
+	TEST_ASSERT_TRUE(pipelined.StartSample());
+	TEST_ASSERT_TRUE(pipelined.FinishSample());
+	TEST_ASSERT_EQUAL_UINT8(AX, bus.ucLastReg);
+	TEST_ASSERT_EQUAL_UINT8(JY901_SAMPLE_BYTES, bus.ucLastLength);
+	assertSample(pipelined);
+	TEST_ASSERT_TRUE(pipelined.stcSample.ulMicros > 0);
+}
+
+// The yaw wraps at +-180 degrees, the rate is signed
+void test_scaling_limits()
+{
+	bus.setRegister(Yaw, (short)0x8000);
+	bus.setRegister(GZ, 0x7FFF);
+	TEST_ASSERT_TRUE(sensor.GetSample());
+	TEST_ASSERT_FLOAT_WITHIN(1e-6, -180.0, sensor.stcSample.Angle[2] * JY901_ANGLE_SCALE);
+	TEST_ASSERT_FLOAT_WITHIN(0.1, 2000.0, sensor.stcSample.w[2] * JY901_RATE_SCALE);
+
+	bus.setRegister(Yaw, 0x7FFF);
+	bus.setRegister(GZ, (short)0x8000);
+	TEST_ASSERT_TRUE(sensor.GetSample());
+	TEST_ASSERT_FLOAT_WITHIN(0.01, 180.0, sensor.stcSample.Angle[2] * JY901_ANGLE_SCALE);
+	TEST_ASSERT_FLOAT_WITHIN(1e-6, -2000.0, sensor.stcSample.w[2] * JY901_RATE_SCALE);
+}
+
+// A failed read leaves the last sample as it was
+void test_failed_read_keeps_the_sample()
+{
+	TEST_ASSERT_TRUE(sensor.GetSample());
+	bus.setRegister(Yaw, 0);
+	bus.ulFailNext = 1;
+	TEST_ASSERT_FALSE(sensor.GetSample());
+	assertSample(sensor);
+}
+
+int main()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_sample_layout);
+	RUN_TEST(test_burst_read_decodes_every_register);
+	RUN_TEST(test_pipelined_read_decodes_every_register);
+	RUN_TEST(test_scaling_limits);
+	RUN_TEST(test_failed_read_keeps_the_sample);
+	return UNITY_END();
+}
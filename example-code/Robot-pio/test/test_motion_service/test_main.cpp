@@ -0,0 +1,166 @@
+// Multi-threaded tests of the lock-free rings and the motion service: every item
+// must arrive once, in order and intact, with the two sides on different threads.
+#include <unity.h>
+#include <thread>
+#include "MotionService.h"
+
+#define RING_ITEMS 2000000UL
+#define SERVICE_COMMANDS 5000UL
+
+// Large enough that a torn copy would show as a mismatch
+struct Item
+{
+    uint32_t sequence;
+    uint32_t check;
+    double value;
+};
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_ring_fills_and_empties()
+{
+    SpscRing<uint32_t, 8> ring;
+    uint32_t item;
+    TEST_ASSERT_TRUE(ring.isEmpty());
+    TEST_ASSERT_FALSE(ring.pop(&item));
+    for (uint32_t i = 0; i < 8; i++)
+        TEST_ASSERT_TRUE(ring.push(i));
+    TEST_ASSERT_FALSE(ring.push(8));
+    TEST_ASSERT_EQUAL_UINT32(8, ring.size());
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        TEST_ASSERT_TRUE(ring.pop(&item));
+        TEST_ASSERT_EQUAL_UINT32(i, item);
+    }
+    TEST_ASSERT_TRUE(ring.isEmpty());
+}
+
+void test_ring_keeps_order_across_threads()
+{
+    static SpscRing<Item, 16> ring;
+    uint32_t fullSpins = 0;
+
+    std::thread producer([&]()
+                         {
+        for (uint32_t i = 0; i < RING_ITEMS; i++)
+        {
+            Item item = {i, ~i, i * 0.5};
+            while (!ring.push(item))
+            {
+                fullSpins++;
+                std::this_thread::yield();
+            }
+        } });
+
+    uint32_t expected = 0;
+    uint32_t errors = 0;
+    Item item;
+    while (expected < RING_ITEMS)
+    {
+        if (!ring.pop(&item))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        if (item.sequence != expected || item.check != ~expected || item.value != expected * 0.5)
+            errors++;
+        expected++;
+    }
+    producer.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, errors);
+    TEST_ASSERT_EQUAL_UINT32(RING_ITEMS, expected);
+    TEST_ASSERT_TRUE(ring.isEmpty());
+    // The consumer was slow at times, so the full ring was hit and recovered from
+    TEST_ASSERT_GREATER_THAN(0, fullSpins);
+}
+
+void test_service_runs_every_command_in_order()
+{
+    static RecordingMotionExecutor executor;
+    static MotionService service;
+    service.begin(&executor);
+
+    const MotionType types[] = {MOTION_MOVE, MOTION_TURN, MOTION_STOP, MOTION_ARC};
+    uint32_t popped = 0;
+    uint32_t lastId = 0;
+    uint32_t outOfOrder = 0;
+    MotionCompletion completion;
+    MotionHandle handle;
+    for (uint32_t i = 0; i < SERVICE_COMMANDS; i++)
+    {
+        handle = service.submit(types[i % 4], i, nullptr, nullptr, 0, i % 7);
+        // Drain now and then, so the completion ring also overflows at times
+        if (i % 64 == 0)
+        {
+            while (service.popCompletion(&completion))
+            {
+                if (completion.id <= lastId || !completion.finished)
+                    outOfOrder++;
+                lastId = completion.id;
+                popped++;
+            }
+        }
+    }
+    TEST_ASSERT_TRUE(handle.wait(10000));
+    TEST_ASSERT_TRUE(service.isIdle());
+    while (service.popCompletion(&completion))
+    {
+        if (completion.id <= lastId)
+            outOfOrder++;
+        lastId = completion.id;
+        popped++;
+    }
+
+    std::lock_guard<std::mutex> lock(executor.mutex);
+    TEST_ASSERT_EQUAL_UINT32(SERVICE_COMMANDS, executor.commands.size());
+    for (uint32_t i = 0; i < SERVICE_COMMANDS; i++)
+    {
+        const MotionCommand &command = executor.commands[i];
+        TEST_ASSERT_EQUAL_UINT32(i + 1, command.id);
+        TEST_ASSERT_EQUAL(types[i % 4], command.type);
+        TEST_ASSERT_EQUAL_FLOAT((float)i, (float)command.value);
+        TEST_ASSERT_EQUAL_FLOAT((float)(i % 7), (float)command.radius);
+    }
+
+    // A completion is either read back or counted as dropped, never lost silently
+    TEST_ASSERT_EQUAL_UINT32(0, outOfOrder);
+    TEST_ASSERT_EQUAL_UINT32(SERVICE_COMMANDS, popped + service.droppedCompletions());
+    TEST_ASSERT_EQUAL_UINT32(SERVICE_COMMANDS, service.completed());
+}
+
+void test_handle_waits_for_its_command()
+{
+    static RecordingMotionExecutor executor;
+    static MotionService service;
+    executor.durationMs = 20;
+    service.begin(&executor);
+
+    MotionHandle first = service.submit(MOTION_MOVE, 100);
+    MotionHandle second = service.submit(MOTION_TURN, 90);
+    TEST_ASSERT_FALSE(second.isDone());
+    TEST_ASSERT_FALSE(second.wait(5));
+    TEST_ASSERT_TRUE(first.wait(1000));
+    TEST_ASSERT_TRUE(second.wait(1000));
+    TEST_ASSERT_TRUE(service.isIdle());
+
+    MotionCompletion completion;
+    TEST_ASSERT_TRUE(service.popCompletion(&completion));
+    TEST_ASSERT_EQUAL_UINT32(first.id(), completion.id);
+    TEST_ASSERT_GREATER_OR_EQUAL(20000, completion.finishedAt - completion.startedAt);
+    TEST_ASSERT_TRUE(service.popCompletion(&completion));
+    TEST_ASSERT_EQUAL_UINT32(second.id(), completion.id);
+    TEST_ASSERT_FALSE(service.popCompletion(&completion));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_ring_fills_and_empties);
+    RUN_TEST(test_ring_keeps_order_across_threads);
+    RUN_TEST(test_service_runs_every_command_in_order);
+    RUN_TEST(test_handle_waits_for_its_command);
+    return UNITY_END();
+}
@@ -0,0 +1,172 @@
+// Host tests of the sequence optimizer: turn normalisation, merging of moves, turns
+// and stops, and removal of no-ops, on sequences decoded from bytecode as on loading.
+#include <unity.h>
+#include <vector>
+#include "Commands.h"
+#include "Optimizer.h"
+
+static std::vector<Command> decode(const CommandSequence &sequence)
+{
+    std::vector<Command> commands;
+    CommandReader reader(sequence);
+    Command command;
+    while (reader.next(&command))
+        commands.push_back(command);
+    TEST_ASSERT_TRUE(reader.atEnd());
+    return commands;
+}
+
+static std::vector<Command> optimize(const CommandSequence &sequence)
+{
+    return SequenceOptimizer::optimize(decode(sequence));
+}
+
+static void assertCommand(Opcode op, double value, const Command &command)
+{
+    TEST_ASSERT_EQUAL(op, command.op);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, value, command.value);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_normalize_angle()
+{
+    TEST_ASSERT_EQUAL_FLOAT(-90, SequenceOptimizer::normalizeAngle(270));
+    TEST_ASSERT_EQUAL_FLOAT(90, SequenceOptimizer::normalizeAngle(-270));
+    TEST_ASSERT_EQUAL_FLOAT(-170, SequenceOptimizer::normalizeAngle(190));
+    TEST_ASSERT_EQUAL_FLOAT(170, SequenceOptimizer::normalizeAngle(-190));
+    TEST_ASSERT_EQUAL_FLOAT(0, SequenceOptimizer::normalizeAngle(360));
+    TEST_ASSERT_EQUAL_FLOAT(0, SequenceOptimizer::normalizeAngle(-360));
+    TEST_ASSERT_EQUAL_FLOAT(45, SequenceOptimizer::normalizeAngle(45));
+    TEST_ASSERT_EQUAL_FLOAT(90, SequenceOptimizer::normalizeAngle(450));
+}
+
+// A half turn is as short either way, it keeps the direction it was given
+void test_half_turn_keeps_direction()
+{
+    TEST_ASSERT_EQUAL_FLOAT(180, SequenceOptimizer::normalizeAngle(180));
+    TEST_ASSERT_EQUAL_FLOAT(-180, SequenceOptimizer::normalizeAngle(-180));
+    TEST_ASSERT_EQUAL_FLOAT(180, SequenceOptimizer::normalizeAngle(540));
+    TEST_ASSERT_EQUAL_FLOAT(-180, SequenceOptimizer::normalizeAngle(-540));
+
+    std::vector<Command> out = optimize(CommandSequence().r().r());
+    TEST_ASSERT_EQUAL(1, out.size());
+    assertCommand(OP_TURN, 180, out[0]);
+    out = optimize(CommandSequence().l().l());
+    TEST_ASSERT_EQUAL(1, out.size());
+    assertCommand(OP_TURN, -180, out[0]);
+}
+
+void test_turns_go_the_shorter_way()
+{
+    std::vector<Command> out = optimize(CommandSequence().l(270).f().r(300));
+    TEST_ASSERT_EQUAL(3, out.size());
+    assertCommand(OP_TURN, 90, out[0]);
+    assertCommand(OP_MOVE, 500, out[1]);
+    assertCommand(OP_TURN, -60, out[2]);
+
+    out = optimize(CommandSequence().r().r().r());
+    TEST_ASSERT_EQUAL(1, out.size());
+    assertCommand(OP_TURN, -90, out[0]);
+}
+
+void test_moves_merge_up_to_max_distance()
+{
+    std::vector<Command> out = optimize(CommandSequence().f().f(700).b(300).b(200));
+    TEST_ASSERT_EQUAL(2, out.size());
+    assertCommand(OP_MOVE, 1200, out[0]);
+    assertCommand(OP_MOVE, -500, out[1]);
+
+    // A merge that would pass MAX_DISTANCE starts a new move
+    out = optimize(CommandSequence().f(1000).f(1000).f(1000).f(MAX_DISTANCE));
+    TEST_ASSERT_EQUAL(3, out.size());
+    assertCommand(OP_MOVE, 2000, out[0]);
+    assertCommand(OP_MOVE, 1000, out[1]);
+    assertCommand(OP_MOVE, MAX_DISTANCE, out[2]);
+    for (const Command &command : out)
+        TEST_ASSERT_TRUE(command.value <= MAX_DISTANCE);
+
+    out = optimize(CommandSequence().b(MAX_DISTANCE).b(1));
+    TEST_ASSERT_EQUAL(2, out.size());
+    assertCommand(OP_MOVE, -MAX_DISTANCE, out[0]);
+    assertCommand(OP_MOVE, -1, out[1]);
+}
+
+// Opposite moves are kept, the robot may be meant to drive over a point and back
+void test_opposite_moves_are_kept()
+{
+    std::vector<Command> out = optimize(CommandSequence().f(300).b(300));
+    TEST_ASSERT_EQUAL(2, out.size());
+    assertCommand(OP_MOVE, 300, out[0]);
+    assertCommand(OP_MOVE, -300, out[1]);
+}
+
+void test_stops_merge()
+{
+    std::vector<Command> out = optimize(CommandSequence().stop(3000).stop(5000).f().stop(100));
+    TEST_ASSERT_EQUAL(3, out.size());
+    assertCommand(OP_STOP, 8000, out[0]);
+    assertCommand(OP_MOVE, 500, out[1]);
+    assertCommand(OP_STOP, 100, out[2]);
+
+    // Only up to what a stop operand holds
+    out = optimize(CommandSequence().stop(40000).stop(40000));
+    TEST_ASSERT_EQUAL(2, out.size());
+    assertCommand(OP_STOP, 40000, out[0]);
+    assertCommand(OP_STOP, 40000, out[1]);
+}
+
+void test_no_ops_are_dropped()
+{
+    std::vector<Command> out = optimize(CommandSequence().f(0).r(0).stop(0).arc(200, 0).pivot(0).r(360).l(0.04).f());
+    TEST_ASSERT_EQUAL(1, out.size());
+    assertCommand(OP_MOVE, 500, out[0]);
+
+    // Turns that cancel out leave the moves around them to merge
+    out = optimize(CommandSequence().f().l().r().f().r(90).r(-90).f());
+    TEST_ASSERT_EQUAL(1, out.size());
+    assertCommand(OP_MOVE, 1500, out[0]);
+}
+
+// The turn calibration of README, eight l() fold to 720 degrees, which is no turn at all.
+// Loading nothing would skip the calibration run without a word.
+void test_cancelling_sequence_is_kept_with_a_warning()
+{
+    const char *warning = "";
+    std::vector<Command> calibration = decode(CommandSequence().l().l().l().l().l().l().l().l());
+    std::vector<Command> out = SequenceOptimizer::optimize(calibration, &warning);
+    TEST_ASSERT_NOT_NULL(warning);
+    TEST_ASSERT_EQUAL(8, out.size());
+    for (const Command &command : out)
+        assertCommand(OP_TURN, -90, command);
+
+    out = SequenceOptimizer::optimize(decode(CommandSequence().f().l().r().r().l()), &warning);
+    TEST_ASSERT_NULL(warning);
+    TEST_ASSERT_EQUAL(1, out.size());
+}
+
+void test_other_commands_are_kept()
+{
+    std::vector<Command> out = optimize(CommandSequence().arc(200, 90).arc(200, 90).pivot(45).pivot(45));
+    TEST_ASSERT_EQUAL(4, out.size());
+    assertCommand(OP_ARC, 90, out[0]);
+    TEST_ASSERT_EQUAL_FLOAT(200, out[0].radius);
+    assertCommand(OP_PIVOT, 45, out[3]);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_normalize_angle);
+    RUN_TEST(test_half_turn_keeps_direction);
+    RUN_TEST(test_turns_go_the_shorter_way);
+    RUN_TEST(test_moves_merge_up_to_max_distance);
+    RUN_TEST(test_opposite_moves_are_kept);
+    RUN_TEST(test_stops_merge);
+    RUN_TEST(test_no_ops_are_dropped);
+    RUN_TEST(test_cancelling_sequence_is_kept_with_a_warning);
+    RUN_TEST(test_other_commands_are_kept);
+    return UNITY_END();
+}
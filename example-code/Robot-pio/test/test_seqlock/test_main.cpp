@@ -0,0 +1,121 @@
+// One writer and three readers on a SeqLock, as the IMU task publishes its samples to the
+// control loops: every value read must be one whole write, never parts of two, and the
+// readers must see the writes in order.
+#include <unity.h>
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include "SeqLock.h"
+
+#define WRITES 200000UL
+#define READERS 3
+
+// Laid out like ImuSample, every field derived from the sequence so a mix of two writes shows
+struct Sample
+{
+    double angle;
+    double yaw;
+    double rate;
+    uint32_t micros;
+    uint32_t sequence;
+};
+
+static Sample sampleFor(uint32_t sequence)
+{
+    return {sequence * 0.5, -(double)sequence, sequence * 3.0, sequence * 2000, sequence};
+}
+
+static bool isWhole(const Sample &sample)
+{
+    Sample expected = sampleFor(sample.sequence);
+    return sample.angle == expected.angle && sample.yaw == expected.yaw &&
+           sample.rate == expected.rate && sample.micros == expected.micros;
+}
+
+struct ReaderResult
+{
+    unsigned long reads;
+    unsigned long torn;
+    unsigned long backwards;
+    unsigned long distinct; // different writes seen
+};
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_single_thread()
+{
+    SeqLock<Sample> lock;
+    Sample sample = lock.read();
+    TEST_ASSERT_EQUAL_UINT32(0, sample.sequence);
+    TEST_ASSERT_TRUE(sample.angle == 0);
+    TEST_ASSERT_EQUAL_UINT32(0, lock.writes());
+
+    lock.write(sampleFor(7));
+    lock.write(sampleFor(8));
+    sample = lock.read();
+    TEST_ASSERT_EQUAL_UINT32(8, sample.sequence);
+    TEST_ASSERT_TRUE(isWhole(sample));
+    TEST_ASSERT_EQUAL_UINT32(2, lock.writes());
+}
+
+void test_one_writer_three_readers()
+{
+    static SeqLock<Sample> lock;
+    std::atomic<bool> done{false};
+    ReaderResult results[READERS] = {};
+
+    std::thread readers[READERS];
+    for (int r = 0; r < READERS; r++)
+    {
+        readers[r] = std::thread([&done, &results, r]()
+                                 {
+            ReaderResult &result = results[r];
+            uint32_t last = 0;
+            while (!done.load())
+            {
+                Sample sample = lock.read();
+                result.reads++;
+                if (!isWhole(sample))
+                    result.torn++;
+                if (sample.sequence < last)
+                    result.backwards++;
+                else if (sample.sequence > last)
+                    result.distinct++;
+                last = sample.sequence;
+                // One CPU is enough for the test, the writer must get its turn
+                if (result.reads % 64 == 0)
+                    std::this_thread::yield();
+            } });
+    }
+
+    for (uint32_t i = 1; i <= WRITES; i++)
+    {
+        lock.write(sampleFor(i));
+        if (i % 64 == 0)
+            std::this_thread::yield();
+    }
+    done.store(true);
+    for (int r = 0; r < READERS; r++)
+        readers[r].join();
+
+    for (int r = 0; r < READERS; r++)
+    {
+        printf("reader %d: %lu reads, %lu writes seen, %lu torn, %lu out of order\n",
+               r, results[r].reads, results[r].distinct, results[r].torn, results[r].backwards);
+        TEST_ASSERT_EQUAL_UINT32(0, results[r].torn);
+        TEST_ASSERT_EQUAL_UINT32(0, results[r].backwards);
+        TEST_ASSERT_TRUE(results[r].distinct > 0);
+    }
+    TEST_ASSERT_EQUAL_UINT32(WRITES, lock.writes());
+    TEST_ASSERT_EQUAL_UINT32(WRITES, lock.read().sequence);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_single_thread);
+    RUN_TEST(test_one_writer_three_readers);
+    return UNITY_END();
+}
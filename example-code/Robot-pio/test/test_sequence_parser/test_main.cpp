@@ -0,0 +1,144 @@
+// Host tests of the serial sequence parser: the bytecode it writes must equal the
+// CommandSequence built in code, and rejected lines must name the error and its column.
+#include <unity.h>
+#include <string.h>
+#include <string>
+#include "SequenceParser.h"
+
+// Set in src/config.cpp on the robot
+const double WHEEL_DISTANCE = 155.8; // mm
+
+static SequenceParser parser;
+
+// Feed a line as the serial monitor sends it, with its line end, and return the result
+static SequenceParser::Result parse(const char *line)
+{
+    parser.reset();
+    SequenceParser::Result result = SequenceParser::PARSE_MORE;
+    for (const char *c = line; *c && result == SequenceParser::PARSE_MORE; c++)
+        result = parser.feed(*c);
+    if (result == SequenceParser::PARSE_MORE)
+        result = parser.feed('\n');
+    return result;
+}
+
+static void assertSequence(const CommandSequence &expected, const char *line)
+{
+    TEST_ASSERT_EQUAL_MESSAGE(SequenceParser::PARSE_DONE, parse(line), line);
+    const CommandSequence &parsed = parser.sequence();
+    TEST_ASSERT_EQUAL_UINT32(expected.size(), parsed.size());
+    TEST_ASSERT_EQUAL_UINT32(expected.length(), parsed.length());
+    TEST_ASSERT_EQUAL_MEMORY(expected.code(), parsed.code(), expected.length());
+    TEST_ASSERT_TRUE(parsed.valid());
+}
+
+static void assertError(const char *error, size_t column, const char *line)
+{
+    TEST_ASSERT_EQUAL_MESSAGE(SequenceParser::PARSE_ERROR, parse(line), line);
+    TEST_ASSERT_EQUAL_STRING(error, parser.error());
+    TEST_ASSERT_EQUAL_UINT32(column, parser.errorColumn());
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_commands()
+{
+    assertSequence(CommandSequence().f(500).l().r(90).b(300).stop(2000).arc(200, -90).pivot(45),
+                   "f500 l r90 b300 s2000 a200,-90 p45");
+    // Values left out take the CommandSequence defaults
+    assertSequence(CommandSequence().f().b().l().r().pivot().arc(300), "f b l r p a300");
+    assertSequence(CommandSequence().r(12.3).l(-45.5).arc(150.4, 30.25).f(-20).b(+20), "r12.3 l-45.5 a150.4,30.25 f-20 b+20");
+}
+
+void test_separators_comments_and_case()
+{
+    assertSequence(CommandSequence().f(500).l().f(200), "F500;L\tf200");
+    assertSequence(CommandSequence().f(500).l().r(), "f500l r");
+    assertSequence(CommandSequence().f(100).r(), "  f100 r # then back to the start: b100");
+    assertSequence(CommandSequence().f(100).r(), "f100 r#comment");
+}
+
+void test_line_ends()
+{
+    parser.reset();
+    const char *line = "f100\r\n";
+    TEST_ASSERT_EQUAL(SequenceParser::PARSE_MORE, parser.feed(line[0]));
+    for (int i = 1; i < 4; i++)
+        parser.feed(line[i]);
+    TEST_ASSERT_EQUAL(SequenceParser::PARSE_DONE, parser.feed('\r'));
+    parser.reset();
+    // The '\n' of "\r\n" does not end a second, empty line
+    TEST_ASSERT_EQUAL(SequenceParser::PARSE_MORE, parser.feed('\n'));
+
+    TEST_ASSERT_EQUAL(SequenceParser::PARSE_EMPTY, parse("   "));
+    TEST_ASSERT_EQUAL(SequenceParser::PARSE_EMPTY, parse("# just a comment"));
+}
+
+void test_errors_name_the_column()
+{
+    assertError("unknown command", 6, "f500 x r");
+    assertError("distance beyond MAX_DISTANCE", 6, "f500 f2501");
+    assertError("distance in whole mm expected", 1, "f1.5");
+    assertError("angle beyond MAX_ANGLE", 1, "l361");
+    assertError("stop time expected", 4, "f1 s");
+    assertError("stop time of 0 to 65535 ms expected", 1, "s70000");
+    assertError("arc radius expected", 1, "a");
+    assertError("arc radius expected", 2, "a,90");
+    assertError("angle beyond MAX_ANGLE", 1, "a200,400");
+    assertError("arc beyond MAX_DISTANCE", 1, "a2000,180");
+    // The middle drives 2435 mm, the outer wheel 2557 mm: the parser knows WHEEL_DISTANCE,
+    // a constexpr sequence only checks the middle and is rejected when it is loaded
+    assertError("arc beyond MAX_DISTANCE", 1, "a1550,90");
+    TEST_ASSERT_TRUE(CommandSequence().arc(1550, 90).valid());
+    TEST_ASSERT_FALSE(CommandSequence().arc(1600, 90).valid());
+    assertError("number expected", 2, "f-");
+    assertError("unexpected character", 3, "f5-");
+    assertError("number too long", 11, "f1234567890");
+}
+
+void test_sequence_too_long()
+{
+    std::string line;
+    for (int i = 0; i < COMMAND_CODE_SIZE / 3 + 1; i++)
+        line += "f1 ";
+    assertError("sequence longer than COMMAND_CODE_SIZE", COMMAND_CODE_SIZE + 1, line.c_str());
+}
+
+// After a rejected line the parser starts over on the next one
+void test_recovers_after_error()
+{
+    parser.reset();
+    const char *text = "f500 x\nf200 l\n";
+    SequenceParser::Result results[2];
+    int lines = 0;
+    for (const char *c = text; *c; c++)
+    {
+        SequenceParser::Result result = parser.feed(*c);
+        if (result == SequenceParser::PARSE_MORE)
+            continue;
+        results[lines++] = result;
+        if (result == SequenceParser::PARSE_DONE)
+        {
+            CommandSequence expected = CommandSequence().f(200).l();
+            TEST_ASSERT_EQUAL_MEMORY(expected.code(), parser.sequence().code(), expected.length());
+        }
+        parser.reset();
+    }
+    TEST_ASSERT_EQUAL(2, lines);
+    TEST_ASSERT_EQUAL(SequenceParser::PARSE_ERROR, results[0]);
+    TEST_ASSERT_EQUAL(SequenceParser::PARSE_DONE, results[1]);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_commands);
+    RUN_TEST(test_separators_comments_and_case);
+    RUN_TEST(test_line_ends);
+    RUN_TEST(test_errors_name_the_column);
+    RUN_TEST(test_sequence_too_long);
+    RUN_TEST(test_recovers_after_error);
+    return UNITY_END();
+}
@@ -0,0 +1,204 @@
+// Host tests of the step engine on its virtual timer: pulse counts, pulse timing
+// and how far the two wheels drift apart from their exact ratio.
+#include <unity.h>
+#include <stdlib.h>
+#include "StepEngine.h"
+
+// The robot's straight move limits at 1/16 microstepping
+#define SPEED 6400.0f
+#define ACCEL 9600.0f
+#define JERK 76800.0f
+
+struct Trace
+{
+    long steps[STEP_CHANNELS];
+    long expected[STEP_CHANNELS];
+    float phaseError; // largest distance of the slower wheel from its exact ratio, steps
+    uint64_t lastPulse[STEP_CHANNELS];
+    uint32_t longestGap; // longest interval between pulses of the faster wheel, us
+    uint32_t shortestGap;
+};
+
+static StepEngine engine;
+static Trace trace;
+
+static void onPulse(uint8_t mask, uint64_t timeUs, void *context)
+{
+    Trace &t = *(Trace *)context;
+    for (uint8_t i = 0; i < STEP_CHANNELS; i++)
+    {
+        if (!(mask & (1 << i)))
+            continue;
+        if (t.lastPulse[i] && labs(t.expected[i]) >= labs(t.expected[1 - i]))
+        {
+            uint32_t gap = (uint32_t)(timeUs - t.lastPulse[i]);
+            if (gap > t.longestGap)
+                t.longestGap = gap;
+            if (gap < t.shortestGap)
+                t.shortestGap = gap;
+        }
+        t.lastPulse[i] = timeUs;
+        t.steps[i]++;
+    }
+
+    // Where the slower wheel should be for the steps the faster wheel has done
+    uint8_t fast = labs(t.expected[0]) >= labs(t.expected[1]) ? 0 : 1;
+    uint8_t slow = 1 - fast;
+    float exact = (float)t.steps[fast] * labs(t.expected[slow]) / labs(t.expected[fast]);
+    float error = fabsf(t.steps[slow] - exact);
+    if (error > t.phaseError)
+        t.phaseError = error;
+}
+
+static void run(long left, long right)
+{
+    trace = Trace();
+    trace.expected[STEP_LEFT] = left;
+    trace.expected[STEP_RIGHT] = right;
+    trace.shortestGap = UINT32_MAX;
+    engine.clearFirstStep();
+    engine.start(left, right);
+    engine.runUntilIdle();
+}
+
+void setUp()
+{
+    engine.setPulseHook(onPulse, &trace);
+    engine.configure(SPEED, ACCEL);
+}
+
+void tearDown() {}
+
+void test_pulse_counts_are_exact()
+{
+    const long moves[][2] = {{1, 1}, {2, 0}, {0, 7}, {1600, 1600}, {-1600, -1600}, {3200, -3200},
+                             {4000, 1357}, {-999, 1000}, {40000, 39999}, {12345, 1}};
+    for (const long *move : moves)
+    {
+        run(move[0], move[1]);
+        TEST_ASSERT_EQUAL(labs(move[0]), trace.steps[STEP_LEFT]);
+        TEST_ASSERT_EQUAL(labs(move[1]), trace.steps[STEP_RIGHT]);
+        TEST_ASSERT_EQUAL(move[0], engine.position(STEP_LEFT));
+        TEST_ASSERT_EQUAL(move[1], engine.position(STEP_RIGHT));
+        TEST_ASSERT_FALSE(engine.isRunning());
+    }
+}
+
+void test_pulse_counts_are_exact_with_s_curve()
+{
+    engine.configure(SPEED, ACCEL, JERK);
+    const long moves[][2] = {{3, 3}, {160, 160}, {1600, -1600}, {16000, 5000}, {40000, 40000}};
+    for (const long *move : moves)
+    {
+        run(move[0], move[1]);
+        TEST_ASSERT_EQUAL(labs(move[0]), trace.steps[STEP_LEFT]);
+        TEST_ASSERT_EQUAL(labs(move[1]), trace.steps[STEP_RIGHT]);
+    }
+}
+
+void test_wheels_stay_within_a_step_of_their_ratio()
+{
+    const long moves[][2] = {{4000, 1357}, {1357, 4000}, {16000, 15999}, {8000, -4000}, {5000, 1}, {7, 3}};
+    for (const long *move : moves)
+    {
+        run(move[0], move[1]);
+        TEST_ASSERT_LESS_OR_EQUAL(1.0f, trace.phaseError);
+    }
+}
+
+void test_pulse_intervals_stay_within_speed_limits()
+{
+    run(32000, 32000);
+    uint32_t fastest = (uint32_t)lroundf(1000000.0f / SPEED);
+    TEST_ASSERT_EQUAL_UINT32(fastest, trace.shortestGap);
+    // The first steps of the ramp are the slowest
+    TEST_ASSERT_LESS_OR_EQUAL(STEP_MAX_INTERVAL_US, trace.longestGap);
+}
+
+void test_first_pulse_and_move_time_follow_the_ramp()
+{
+    uint16_t ramp[STEP_RAMP_MAX];
+    uint32_t cruise;
+    uint32_t rampSteps = buildStepRamp(SPEED, ACCEL, ramp, STEP_RAMP_MAX, &cruise);
+    const long steps = 20000;
+    TEST_ASSERT_GREATER_THAN(2 * rampSteps, steps);
+
+    // Pulse k is due after the intervals of steps 0 to k, the ramp mirrored for braking
+    uint64_t expected = 0;
+    for (long k = 0; k < steps; k++)
+    {
+        long fromEnd = steps - 1 - k;
+        long idx = k < fromEnd ? k : fromEnd;
+        expected += (uint32_t)idx < rampSteps ? ramp[idx] : cruise;
+    }
+
+    uint64_t start = engine.virtualNow();
+    run(steps, steps);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)(start + ramp[0]), engine.firstStepTime());
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)expected, (uint32_t)(trace.lastPulse[STEP_LEFT] - start));
+}
+
+// Time from the start of a move to its last pulse, s
+static float moveTime(long steps)
+{
+    uint64_t start = engine.virtualNow();
+    run(steps, steps);
+    return (trace.lastPulse[STEP_LEFT] - start) / 1e6f;
+}
+
+// Intervals are whole us, up to 0.3% off at full speed, on top of a fixed offset from the ramp
+static void checkMoveTimes(float jerk, float offset)
+{
+    engine.configure(SPEED, ACCEL, jerk);
+    // From 1 mm to MAX_DISTANCE, short moves never reach full speed
+    const long moves[] = {16, 160, 800, 1600, 4000, 8000, 16000, 40000};
+    for (long steps : moves)
+    {
+        float predicted = profileMoveTime(steps, SPEED, ACCEL, jerk);
+        float actual = moveTime(steps);
+        char message[80];
+        snprintf(message, sizeof(message), "%ld steps predicted %.4f s", steps, predicted);
+        TEST_ASSERT_FLOAT_WITHIN_MESSAGE(0.003f * predicted + offset, predicted, actual, message);
+    }
+}
+
+// The first step of the trapezoid ramp has AccelStepper's 0.676 correction, about 10 ms
+void test_trapezoid_move_time_matches_profile()
+{
+    checkMoveTimes(0, 0.011f);
+}
+
+void test_s_curve_move_time_matches_profile()
+{
+    checkMoveTimes(JERK, 0.001f);
+}
+
+void test_stop_ends_after_the_current_step()
+{
+    trace = Trace();
+    trace.expected[STEP_LEFT] = 16000;
+    trace.expected[STEP_RIGHT] = 8000;
+    trace.shortestGap = UINT32_MAX;
+    engine.start(16000, 8000);
+    engine.advance(200000);
+    long left = trace.steps[STEP_LEFT];
+    TEST_ASSERT_GREATER_THAN(0, left);
+    engine.stop();
+    TEST_ASSERT_FALSE(engine.isRunning());
+    TEST_ASSERT_EQUAL(left, engine.position(STEP_LEFT));
+    TEST_ASSERT_LESS_OR_EQUAL(1.0f, trace.phaseError);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_pulse_counts_are_exact);
+    RUN_TEST(test_pulse_counts_are_exact_with_s_curve);
+    RUN_TEST(test_wheels_stay_within_a_step_of_their_ratio);
+    RUN_TEST(test_pulse_intervals_stay_within_speed_limits);
+    RUN_TEST(test_first_pulse_and_move_time_follow_the_ramp);
+    RUN_TEST(test_trapezoid_move_time_matches_profile);
+    RUN_TEST(test_s_curve_move_time_matches_profile);
+    RUN_TEST(test_stop_ends_after_the_current_step);
+    return UNITY_END();
+}
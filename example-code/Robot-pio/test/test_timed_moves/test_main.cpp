@@ -0,0 +1,112 @@
+// Host test of timed moves: the stop time is split over the moves of the example run in
+// proportion to their length, as Travel::planDurations does, and the moves are run on the
+// step engine's virtual timer. The predicted and the simulated run must match.
+#include <unity.h>
+#include <stdio.h>
+#include "StepEngine.h"
+#include "MotionTiming.h"
+
+// Moves of the example run, mm
+static const long runMoves[] = {1092, 800, 1000, 500, 500, 1300, 800, 500, 1000, 800,
+                                800, 1000, 500, 1000, 800, 800, 1500, 458};
+#define RUN_MOVES (sizeof(runMoves) / sizeof(runMoves[0]))
+
+// The trapezoid ramp of the engine starts and ends on 0.676 of the exact first step
+// interval, so a trapezoid move ends this much before its profile, ms
+#define RAMP_SHORTFALL (MOVE_JERK > 0 ? 0 : 2 * (1 - 0.676f) * sqrtf(2.0f / MOVE_ACCEL) * 1000)
+
+static StepEngine engine;
+static uint64_t lastPulse;
+
+static void onPulse(uint8_t mask, uint64_t timeUs, void *context)
+{
+    (void)mask;
+    (void)context;
+    lastPulse = timeUs;
+}
+
+// Time of a move on the engine from its start to the last pulse plus the stop after it, ms
+static float simulatedMoveTime(long distance, unsigned long duration)
+{
+    long steps = distance * MICRO_STEPS;
+    engine.configure(speedForDuration(steps, MOVE_SPEED, duration), MOVE_ACCEL, MOVE_JERK);
+    uint64_t start = engine.virtualNow();
+    engine.start(steps, -steps);
+    engine.runUntilIdle();
+    return (lastPulse - start) / 1000.0f + RAMP_SHORTFALL + MIN_STOP_TIME;
+}
+
+struct RunTimes
+{
+    unsigned long fastest;   // every move at full speed, ms
+    unsigned long predicted; // timed moves from the estimates
+    unsigned long leftover;  // stop time the moves could not take up
+    float simulated;         // timed moves on the engine
+};
+
+static RunTimes timedRun(unsigned long stopTime)
+{
+    double totalLength = 0;
+    for (size_t i = 0; i < RUN_MOVES; i++)
+        totalLength += runMoves[i];
+
+    RunTimes run = {};
+    unsigned long spent = 0;
+    for (size_t i = 0; i < RUN_MOVES; i++)
+    {
+        unsigned long fastest = estimateMoveTime(runMoves[i]);
+        unsigned long duration = fastest + lround(stopTime * runMoves[i] / totalLength);
+        unsigned long predicted = estimateMoveTime(runMoves[i], duration);
+        float simulated = simulatedMoveTime(runMoves[i], duration);
+
+        // Rounded up to a speed level a move never overruns its share
+        TEST_ASSERT_TRUE(predicted <= duration);
+        // The ramp of the engine follows the profile to within a step
+        TEST_ASSERT_FLOAT_WITHIN(predicted * 0.003f + 1, predicted, simulated);
+
+        run.fastest += fastest;
+        run.predicted += predicted;
+        run.simulated += simulated;
+        spent += predicted - fastest;
+    }
+    run.leftover = spent < stopTime ? stopTime - spent : 0;
+    printf("stop time %6lu ms: fastest %lu, predicted %lu, simulated %.0f, %lu ms left for stops\n",
+           stopTime, run.fastest, run.predicted, run.simulated, run.leftover);
+    return run;
+}
+
+void setUp()
+{
+    engine.setPulseHook(onPulse, nullptr);
+}
+
+void tearDown() {}
+
+void test_budget_split_totals_match()
+{
+    static const unsigned long stopTimes[] = {0, 5000, 20000, 40000};
+    for (unsigned long stopTime : stopTimes)
+    {
+        RunTimes run = timedRun(stopTime);
+
+        // Driving plus the stops left over fills the run to the fastest time plus the stop time
+        TEST_ASSERT_EQUAL_UINT32(run.fastest + stopTime, run.predicted + run.leftover);
+        TEST_ASSERT_FLOAT_WITHIN(run.predicted * 0.003f + RUN_MOVES, run.predicted, run.simulated);
+    }
+}
+
+// A budget the moves cannot absorb, even at MOVE_MIN_SPEED, is left for the stops
+void test_budget_beyond_min_speed()
+{
+    RunTimes run = timedRun(600000);
+    TEST_ASSERT_GREATER_THAN(0, run.leftover);
+    TEST_ASSERT_FLOAT_WITHIN(run.predicted * 0.003f + RUN_MOVES, run.predicted, run.simulated);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_budget_split_totals_match);
+    RUN_TEST(test_budget_beyond_min_speed);
+    return UNITY_END();
+}
@@ -0,0 +1,154 @@
+// Host tests of the timing model: the move fit and the turn averages converge on the
+// times of a simulated robot that is slower than its motion profile, outliers are left
+// out, and the calibrated turn times are interpolated until learned over.
+#include <unity.h>
+#include <random>
+#include "TimingModel.h"
+
+// Set in src/config.cpp on the robot
+const double WHEEL_DISTANCE = 155.8; // mm
+
+#define SAMPLES 60
+
+// The simulated robot: moves take longer than the profile, e.g. from the time to settle
+#define MOVE_SLOPE 1.08
+#define MOVE_OFFSET 70.0 // ms
+#define MOVE_NOISE 8.0   // ms
+#define TURN_90_TIME 910.0 // ms
+#define TURN_NOISE 15.0    // ms
+
+static const long distances[] = {300, 500, 800, 1000, 1300, 1500, 2000};
+#define DISTANCES (sizeof(distances) / sizeof(distances[0]))
+
+static std::mt19937 generator(7);
+
+static unsigned long robotMoveTime(long distance, unsigned long duration = 0)
+{
+    std::normal_distribution<double> noise(0, MOVE_NOISE);
+    return lround(MOVE_SLOPE * estimateMoveTime(distance, duration) + MOVE_OFFSET + noise(generator));
+}
+
+static unsigned long robotTurnTime()
+{
+    std::normal_distribution<double> noise(0, TURN_NOISE);
+    return lround(TURN_90_TIME + noise(generator));
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_untrained_model_follows_the_profile()
+{
+    TimingModel model(false);
+    for (size_t i = 0; i < DISTANCES; i++)
+        TEST_ASSERT_EQUAL_UINT32(estimateMoveTime(distances[i]), model.moveTime(distances[i]));
+    TEST_ASSERT_EQUAL_UINT32(estimateArcTime(200, 90), model.arcTime(200, 90));
+    TEST_ASSERT_EQUAL_UINT32(estimateTurnTime(90), model.turnTime(-90));
+    // Off the robot nothing is stored
+    TEST_ASSERT_FALSE(model.load());
+    TEST_ASSERT_FALSE(model.save());
+}
+
+void test_move_fit_converges()
+{
+    TimingModel model(false);
+    for (int i = 0; i < SAMPLES; i++)
+    {
+        long distance = distances[i % DISTANCES];
+        TEST_ASSERT_TRUE(model.recordMove(distance, 0, robotMoveTime(distance)));
+    }
+    for (size_t i = 0; i < DISTANCES; i++)
+    {
+        double truth = MOVE_SLOPE * estimateMoveTime(distances[i]) + MOVE_OFFSET;
+        TEST_ASSERT_FLOAT_WITHIN(3 * MOVE_NOISE, truth, model.moveTime(distances[i]));
+    }
+    // Timed moves are fitted on their slowed down profile time
+    double truth = MOVE_SLOPE * estimateMoveTime(1000, 5000) + MOVE_OFFSET;
+    TEST_ASSERT_FLOAT_WITHIN(3 * MOVE_NOISE, truth, model.moveTime(1000, 5000));
+}
+
+// A single length gives an offset only, it must still predict that length
+void test_move_fit_of_one_length()
+{
+    TimingModel model(false);
+    for (int i = 0; i < SAMPLES; i++)
+        model.recordMove(1000, 0, robotMoveTime(1000));
+    double truth = MOVE_SLOPE * estimateMoveTime(1000) + MOVE_OFFSET;
+    TEST_ASSERT_FLOAT_WITHIN(3 * MOVE_NOISE, truth, model.moveTime(1000));
+}
+
+void test_move_outliers_are_not_learned()
+{
+    TimingModel model(false);
+    for (int i = 0; i < SAMPLES; i++)
+        model.recordMove(distances[i % DISTANCES], 0, robotMoveTime(distances[i % DISTANCES]));
+    unsigned long before = model.moveTime(1000);
+
+    // A move that was held up, e.g. by a stall
+    TEST_ASSERT_FALSE(model.recordMove(1000, 0, robotMoveTime(1000) + 1500));
+    TEST_ASSERT_EQUAL_UINT32(before, model.moveTime(1000));
+    // Within TIMING_OUTLIER_MIN_TIME of the model is always learned
+    TEST_ASSERT_TRUE(model.recordMove(1000, 0, before + TIMING_OUTLIER_MIN_TIME / 2));
+}
+
+void test_turn_average_converges()
+{
+    TimingModel model(true);
+    for (int i = 0; i < SAMPLES; i++)
+        TEST_ASSERT_TRUE(model.recordTurn(i % 2 ? 90 : -90, robotTurnTime()));
+    TEST_ASSERT_FLOAT_WITHIN(3 * TURN_NOISE, TURN_90_TIME, model.turnTime(90));
+
+    // A turn that slipped
+    unsigned long before = model.turnTime(90);
+    TEST_ASSERT_FALSE(model.recordTurn(90, 2500));
+    TEST_ASSERT_EQUAL_UINT32(before, model.turnTime(90));
+
+    // Other angles are scaled from it by the turn profile
+    double scaled = before * (double)estimateTurnTime(45) / estimateTurnTime(90);
+    TEST_ASSERT_FLOAT_WITHIN(1, scaled, model.turnTime(45));
+}
+
+void test_turn_follows_a_change()
+{
+    TimingModel model(true);
+    for (int i = 0; i < SAMPLES; i++)
+        model.recordTurn(90, robotTurnTime());
+    // The robot turns a little slower from now on, e.g. on a new floor
+    for (int i = 0; i < SAMPLES; i++)
+        TEST_ASSERT_TRUE(model.recordTurn(90, robotTurnTime() + 60));
+    TEST_ASSERT_FLOAT_WITHIN(3 * TURN_NOISE, TURN_90_TIME + 60, model.turnTime(90));
+}
+
+void test_calibrated_turns_are_interpolated()
+{
+    TimingModel model(true);
+    model.calibrate({{90, 800}, {-180, 1400}});
+    TEST_ASSERT_EQUAL_UINT32(800, model.turnTime(-90));
+    TEST_ASSERT_EQUAL_UINT32(1100, model.turnTime(135));
+    TEST_ASSERT_EQUAL_UINT32(1400, model.turnTime(180));
+
+    // A learned angle takes the place of the calibrated one
+    for (int i = 0; i < SAMPLES; i++)
+        model.recordTurn(90, 1000);
+    TEST_ASSERT_EQUAL_UINT32(1000, model.turnTime(90));
+    TEST_ASSERT_EQUAL_UINT32(1200, model.turnTime(135));
+
+    // Step based turns follow their profile
+    TimingModel steps(false);
+    steps.calibrate({{90, 800}});
+    TEST_ASSERT_EQUAL_UINT32(estimateTurnTime(90), steps.turnTime(90));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_untrained_model_follows_the_profile);
+    RUN_TEST(test_move_fit_converges);
+    RUN_TEST(test_move_fit_of_one_length);
+    RUN_TEST(test_move_outliers_are_not_learned);
+    RUN_TEST(test_turn_average_converges);
+    RUN_TEST(test_turn_follows_a_change);
+    RUN_TEST(test_calibrated_turns_are_interpolated);
+    return UNITY_END();
+}
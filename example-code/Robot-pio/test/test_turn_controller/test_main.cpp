@@ -0,0 +1,140 @@
+// IMU turns on a simulated robot: the controller and the tracking PID run as in
+// Robot::turnWithIMU, the wheels on the step engine's virtual timer, and the IMU
+// reports the angle and gyro rate late, at its own sample rate.
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+#include "StepEngine.h"
+#include "TurnController.h"
+#include "Pid.h"
+
+#define WHEEL_DISTANCE 155.8f // mm
+#define STEPS_PER_MM 16.0f
+#define STEPS_PER_DEGREE (M_PI * WHEEL_DISTANCE / 360.0f * STEPS_PER_MM)
+
+// Robot.h and config.cpp turn settings
+#define TURN_SPEED 3200.0f
+#define TURN_ACCEL (TURN_SPEED * 2.0f)
+#define TURN_MIN_SPEED 16.0f
+#define TURN_ANGLE_THRESHOLD 0.04f
+#define TURN_PID_KP 160.0f
+#define TURN_PID_MAX_CORRECTION (TURN_SPEED * 0.25f)
+#define CONTROL_PERIOD_US 2000
+
+// The JY901 as the robot reads it
+#define IMU_PERIOD_US 5000
+#define IMU_LATENCY_US 20000
+
+struct TurnResult
+{
+    float angle; // where the robot ended, degrees
+    float time;  // s
+};
+
+static StepEngine engine;
+
+static float trueAngle()
+{
+    return engine.position(STEP_LEFT) / STEPS_PER_DEGREE;
+}
+
+// Turn by target degrees, the controller expecting an IMU latency of latency s
+static TurnResult turn(float target, float latency)
+{
+    TurnController controller(TURN_SPEED / STEPS_PER_DEGREE, TURN_ACCEL / STEPS_PER_DEGREE,
+                              TURN_MIN_SPEED / STEPS_PER_DEGREE, latency, TURN_ANGLE_THRESHOLD);
+    float period = CONTROL_PERIOD_US / 1e6f;
+    Pid tracking(TURN_PID_KP, 0, 0, -TURN_PID_MAX_CORRECTION, TURN_PID_MAX_CORRECTION, period);
+
+    // True angle and rate every IMU sample period, the IMU reports them IMU_LATENCY_US later
+    std::vector<float> angles(1, 0);
+    std::vector<float> rates(1, 0);
+    float reference = 0;
+    uint64_t time = 0;
+    engine.setSpeed(0, 0);
+    uint64_t start = engine.virtualNow();
+    while (time < 8000000)
+    {
+        size_t newest = time >= IMU_LATENCY_US ? (time - IMU_LATENCY_US) / IMU_PERIOD_US : 0;
+        float angle = angles[newest];
+        float rate = rates[newest];
+
+        float command = controller.update(target, angle, rate, period);
+        if (command == 0)
+            break;
+        reference = fminf(reference + command * period, target);
+        float speed = command * STEPS_PER_DEGREE + tracking.update(reference, controller.predictedAngle());
+        if (speed < TURN_MIN_SPEED)
+            speed = TURN_MIN_SPEED;
+        engine.setSpeed(speed, speed);
+
+        for (uint64_t end = time + CONTROL_PERIOD_US; time < end; time += 1000)
+        {
+            engine.advance(1000);
+            if ((time + 1000) % IMU_PERIOD_US == 0)
+            {
+                angles.push_back(trueAngle());
+                rates.push_back(engine.speed(STEP_LEFT) / STEPS_PER_DEGREE);
+            }
+        }
+    }
+    engine.stop();
+    TurnResult result = {trueAngle(), (engine.virtualNow() - start) / 1e6f};
+    return result;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_turns_land_on_target()
+{
+    const float targets[] = {5, 15, 45, 90, 135, 180, 270, 360};
+    for (float target : targets)
+    {
+        TurnResult result = turn(target, IMU_LATENCY_US / 1e6f);
+        printf("%5.0f deg: %8.3f deg in %.3f s\n", target, result.angle, result.time);
+        // Within the threshold plus one step of the wheels
+        TEST_ASSERT_FLOAT_WITHIN(TURN_ANGLE_THRESHOLD + 1 / STEPS_PER_DEGREE, target, result.angle);
+    }
+}
+
+// Time of the fastest turn by angle degrees within TURN_SPEED and TURN_ACCEL, s
+static float profileTime(float angle)
+{
+    float steps = angle * STEPS_PER_DEGREE;
+    if (steps < TURN_SPEED * TURN_SPEED / TURN_ACCEL)
+        return 2 * sqrtf(steps / TURN_ACCEL);
+    return steps / TURN_SPEED + TURN_SPEED / TURN_ACCEL;
+}
+
+// The old two-stage turn took 1.6 s for 90 degrees. The fastest 90 degree turn within
+// TURN_SPEED and TURN_ACCEL takes 1.11 s, so a turn well under a second needs higher
+// limits, not a better controller: the turn must take no longer than the profile.
+void test_quarter_turn_has_no_crawl()
+{
+    TurnResult result = turn(90, IMU_LATENCY_US / 1e6f);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.11f, profileTime(90));
+    TEST_ASSERT_LESS_THAN(1.12f, result.time);
+    TEST_ASSERT_LESS_THAN(profileTime(90) + 0.02f, result.time);
+}
+
+// Without projecting the angle over the latency the robot brakes late and overshoots
+void test_latency_prediction_prevents_overshoot()
+{
+    TurnResult predicted = turn(5, IMU_LATENCY_US / 1e6f);
+    TurnResult late = turn(5, 0);
+    printf("5 deg without prediction: %.3f deg in %.3f s\n", late.angle, late.time);
+    TEST_ASSERT_GREATER_THAN(5.2f, late.angle);
+    TEST_ASSERT_LESS_THAN(fabsf(late.angle - 5), fabsf(predicted.angle - 5));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_turns_land_on_target);
+    RUN_TEST(test_quarter_turn_has_no_crawl);
+    RUN_TEST(test_latency_prediction_prevents_overshoot);
+    return UNITY_END();
+}
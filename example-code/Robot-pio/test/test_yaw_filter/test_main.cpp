@@ -0,0 +1,141 @@
+// Replays glitch traces through the yaw filter: every glitch read must be flagged and
+// replaced by the prediction, no clean read may be, and no yaw is held off for longer
+// than MAX_OUTLIER_TIME.
+#include <unity.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "YawFilter.h"
+
+struct TraceSample
+{
+    uint32_t micros; // time of the read
+    double yaw;      // yaw read, degrees
+    double rate;     // rate read with it, degrees/s
+    double truth;    // yaw of the robot, degrees
+    int outlier;     // 1 when the read must be flagged
+};
+
+#include "trace_turn_spike.h"
+#include "trace_wrap.h"
+#include "trace_bump.h"
+#include "trace_stale_reset.h"
+
+#define TRACE_LENGTH(trace) (sizeof(trace) / sizeof(trace[0]))
+
+struct Replay
+{
+    unsigned long flagged;
+    uint32_t longestHold; // us from the first to the last read of a run of outliers
+    double worstError;    // largest distance of the filtered yaw from the truth, degrees
+};
+
+static double wrap(double degrees)
+{
+    while (degrees > 180)
+        degrees -= 360;
+    while (degrees <= -180)
+        degrees += 360;
+    return degrees;
+}
+
+// Feed a trace and check the flag of every read. The distance from the truth counts on
+// flagged reads only with checkFlaggedError: a real step is off the truth while it is held.
+static Replay replay(const TraceSample *trace, size_t length, bool checkFlaggedError)
+{
+    YawFilter filter;
+    Replay result = {0, 0, 0};
+    uint32_t runStart = 0;
+    bool inRun = false;
+    for (size_t i = 0; i < length; i++)
+    {
+        const TraceSample &sample = trace[i];
+        double filtered = filter.update(sample.yaw, sample.rate, sample.micros);
+        TEST_ASSERT_EQUAL_MESSAGE(sample.outlier, filter.outlier(), "outlier flag of a read");
+
+        if (filter.outlier())
+        {
+            result.flagged++;
+            if (!inRun)
+                runStart = sample.micros;
+            inRun = true;
+            if (sample.micros - runStart > result.longestHold)
+                result.longestHold = sample.micros - runStart;
+        }
+        else
+        {
+            inRun = false;
+        }
+
+        if (!filter.outlier() || checkFlaggedError)
+        {
+            double error = fabs(wrap(filtered - sample.truth));
+            if (error > result.worstError)
+                result.worstError = error;
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(result.flagged, filter.outliers());
+    return result;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+// Glitches in a turn are replaced by the prediction from the gyro rate
+void test_turn_spike()
+{
+    Replay result = replay(traceTurnSpike, TRACE_LENGTH(traceTurnSpike), true);
+    TEST_ASSERT_EQUAL_UINT32(6, result.flagged);
+    TEST_ASSERT_TRUE(result.longestHold <= YawFilter::MAX_OUTLIER_TIME);
+    TEST_ASSERT_FLOAT_WITHIN(YawFilter::GATE, 0, result.worstError);
+}
+
+void test_wrap_is_not_a_glitch()
+{
+    Replay result = replay(traceWrap, TRACE_LENGTH(traceWrap), true);
+    TEST_ASSERT_EQUAL_UINT32(0, result.flagged);
+    TEST_ASSERT_FLOAT_WITHIN(YawFilter::GATE, 0, result.worstError);
+}
+
+// A real step is held off no longer than MAX_OUTLIER_TIME, then taken as it is
+void test_real_step_is_taken_after_the_hold()
+{
+    Replay result = replay(traceBump, TRACE_LENGTH(traceBump), false);
+    TEST_ASSERT_TRUE(result.flagged > 0);
+    TEST_ASSERT_TRUE(result.longestHold <= YawFilter::MAX_OUTLIER_TIME);
+    TEST_ASSERT_FLOAT_WITHIN(0.1, 0, result.worstError);
+
+    YawFilter filter;
+    double filtered = 0;
+    uint32_t stepAt = 0;
+    for (size_t i = 0; i < TRACE_LENGTH(traceBump); i++)
+    {
+        filtered = filter.update(traceBump[i].yaw, traceBump[i].rate, traceBump[i].micros);
+        if (!stepAt && traceBump[i].truth > 13)
+            stepAt = traceBump[i].micros;
+        if (stepAt && !filter.outlier())
+        {
+            TEST_ASSERT_TRUE(traceBump[i].micros - stepAt <= YawFilter::MAX_OUTLIER_TIME + 2000);
+            break;
+        }
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.1, 16, filtered);
+}
+
+void test_stale_reads_after_reset()
+{
+    Replay result = replay(traceStaleReset, TRACE_LENGTH(traceStaleReset), true);
+    TEST_ASSERT_EQUAL_UINT32(5, result.flagged);
+    TEST_ASSERT_FLOAT_WITHIN(0.1, 0, result.worstError);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_turn_spike);
+    RUN_TEST(test_wrap_is_not_a_glitch);
+    RUN_TEST(test_real_step_is_taken_after_the_hold);
+    RUN_TEST(test_stale_reads_after_reset);
+    return UNITY_END();
+}
@@ -0,0 +1,106 @@
+// Real step: the robot standing at 10 degrees is knocked to 16 degrees at 100 ms. The new
+// yaw is an outlier at first and is taken once it has held for MAX_OUTLIER_TIME.
+// Columns as in trace_turn_spike.h.
+static const TraceSample traceBump[] = {
+    {0, 10.00, 0.4, 10.00, 0},
+    {2000, 10.00, 0.4, 10.00, 0},
+    {4000, 10.00, 0.4, 10.00, 0},
+    {6000, 9.98, 0.3, 10.00, 0},
+    {8000, 9.98, 0.3, 10.00, 0},
+    {10000, 9.99, -0.1, 10.00, 0},
+    {12000, 9.99, -0.1, 10.00, 0},
+    {14000, 9.99, -0.1, 10.00, 0},
+    {16000, 10.04, 0.0, 10.00, 0},
+    {18000, 10.04, 0.0, 10.00, 0},
+    {20000, 10.00, 0.2, 10.00, 0},
+    {22000, 10.00, 0.2, 10.00, 0},
+    {24000, 10.00, 0.2, 10.00, 0},
+    {26000, 10.02, -0.0, 10.00, 0},
+    {28000, 10.02, -0.0, 10.00, 0},
+    {30000, 10.01, -0.3, 10.00, 0},
+    {32000, 10.01, -0.3, 10.00, 0},
+    {34000, 10.01, -0.3, 10.00, 0},
+    {36000, 9.99, -0.1, 10.00, 0},
+    {38000, 9.99, -0.1, 10.00, 0},
+    {40000, 9.97, -0.5, 10.00, 0},
+    {42000, 9.97, -0.5, 10.00, 0},
+    {44000, 9.97, -0.5, 10.00, 0},
+    {46000, 9.97, -0.1, 10.00, 0},
+    {48000, 9.97, -0.1, 10.00, 0},
+    {50000, 10.00, -0.1, 10.00, 0},
+    {52000, 10.00, -0.1, 10.00, 0},
+    {54000, 10.00, -0.1, 10.00, 0},
+    {56000, 10.00, -0.4, 10.00, 0},
+    {58000, 10.00, -0.4, 10.00, 0},
+    {60000, 10.00, 0.1, 10.00, 0},
+    {62000, 10.00, 0.1, 10.00, 0},
+    {64000, 10.00, 0.1, 10.00, 0},
+    {66000, 10.02, -0.3, 10.00, 0},
+    {68000, 10.02, -0.3, 10.00, 0},
+    {70000, 9.99, -0.6, 10.00, 0},
+    {72000, 9.99, -0.6, 10.00, 0},
+    {74000, 9.99, -0.6, 10.00, 0},
+    {76000, 9.99, -0.7, 10.00, 0},
+    {78000, 9.99, -0.7, 10.00, 0},
+    {80000, 9.97, 0.3, 10.00, 0},
+    {82000, 9.97, 0.3, 10.00, 0},
+    {84000, 9.97, 0.3, 10.00, 0},
+    {86000, 9.96, 0.2, 10.00, 0},
+    {88000, 9.96, 0.2, 10.00, 0},
+    {90000, 10.01, -0.1, 10.00, 0},
+    {92000, 10.01, -0.1, 10.00, 0},
+    {94000, 10.01, -0.1, 10.00, 0},
+    {96000, 10.01, 0.2, 10.00, 0},
+    {98000, 10.01, 0.2, 10.00, 0},
+    {100000, 16.02, -0.1, 16.00, 1},
+    {102000, 16.02, -0.1, 16.00, 1},
+    {104000, 16.02, -0.1, 16.00, 1},
+    {106000, 15.99, -0.2, 16.00, 1},
+    {108000, 15.99, -0.2, 16.00, 1},
+    {110000, 15.98, -0.0, 16.00, 1},
+    {112000, 15.98, -0.0, 16.00, 1},
+    {114000, 15.98, -0.0, 16.00, 1},
+    {116000, 15.98, 0.3, 16.00, 0},
+    {118000, 15.98, 0.3, 16.00, 0},
+    {120000, 15.96, -0.3, 16.00, 0},
+    {122000, 15.96, -0.3, 16.00, 0},
+    {124000, 15.96, -0.3, 16.00, 0},
+    {126000, 15.98, -0.6, 16.00, 0},
+    {128000, 15.98, -0.6, 16.00, 0},
+    {130000, 16.04, -0.7, 16.00, 0},
+    {132000, 16.04, -0.7, 16.00, 0},
+    {134000, 16.04, -0.7, 16.00, 0},
+    {136000, 15.99, -0.2, 16.00, 0},
+    {138000, 15.99, -0.2, 16.00, 0},
+    {140000, 16.03, -0.6, 16.00, 0},
+    {142000, 16.03, -0.6, 16.00, 0},
+    {144000, 16.03, -0.6, 16.00, 0},
+    {146000, 16.02, -0.2, 16.00, 0},
+    {148000, 16.02, -0.2, 16.00, 0},
+    {150000, 16.00, -0.2, 16.00, 0},
+    {152000, 16.00, -0.2, 16.00, 0},
+    {154000, 16.00, -0.2, 16.00, 0},
+    {156000, 16.01, -0.3, 16.00, 0},
+    {158000, 16.01, -0.3, 16.00, 0},
+    {160000, 16.00, 0.1, 16.00, 0},
+    {162000, 16.00, 0.1, 16.00, 0},
+    {164000, 16.00, 0.1, 16.00, 0},
+    {166000, 16.04, -0.7, 16.00, 0},
+    {168000, 16.04, -0.7, 16.00, 0},
+    {170000, 16.03, 0.3, 16.00, 0},
+    {172000, 16.03, 0.3, 16.00, 0},
+    {174000, 16.03, 0.3, 16.00, 0},
+    {176000, 15.99, 0.1, 16.00, 0},
+    {178000, 15.99, 0.1, 16.00, 0},
+    {180000, 15.99, 0.5, 16.00, 0},
+    {182000, 15.99, 0.5, 16.00, 0},
+    {184000, 15.99, 0.5, 16.00, 0},
+    {186000, 16.00, -0.1, 16.00, 0},
+    {188000, 16.00, -0.1, 16.00, 0},
+    {190000, 16.00, -0.1, 16.00, 0},
+    {192000, 16.00, -0.1, 16.00, 0},
+    {194000, 16.00, -0.1, 16.00, 0},
+    {196000, 16.00, -0.3, 16.00, 0},
+    {198000, 16.00, -0.3, 16.00, 0},
+    {200000, 16.04, -0.6, 16.00, 0},
+};
@@ -0,0 +1,55 @@
+// Stale reads after a yaw reset: the robot stands at 0 degrees, two sensor updates at
+// 10 and 15 ms still return the 45 degrees of before the reset. Columns as in trace_turn_spike.h.
+static const TraceSample traceStaleReset[] = {
+    {0, 0.00, 0.1, 0.00, 0},
+    {2000, 0.00, 0.1, 0.00, 0},
+    {4000, 0.00, 0.1, 0.00, 0},
+    {6000, -0.01, 0.1, 0.00, 0},
+    {8000, -0.01, 0.1, 0.00, 0},
+    {10000, 45.00, 0.1, 0.00, 1},
+    {12000, 45.00, 0.1, 0.00, 1},
+    {14000, 45.00, 0.1, 0.00, 1},
+    {16000, 45.00, -0.3, 0.00, 1},
+    {18000, 45.00, -0.3, 0.00, 1},
+    {20000, 0.00, -0.2, 0.00, 0},
+    {22000, 0.00, -0.2, 0.00, 0},
+    {24000, 0.00, -0.2, 0.00, 0},
+    {26000, -0.02, -0.1, 0.00, 0},
+    {28000, -0.02, -0.1, 0.00, 0},
+    {30000, 0.00, 0.1, 0.00, 0},
+    {32000, 0.00, 0.1, 0.00, 0},
+    {34000, 0.00, 0.1, 0.00, 0},
+    {36000, 0.01, 0.7, 0.00, 0},
+    {38000, 0.01, 0.7, 0.00, 0},
+    {40000, 0.02, -0.5, 0.00, 0},
+    {42000, 0.02, -0.5, 0.00, 0},
+    {44000, 0.02, -0.5, 0.00, 0},
+    {46000, 0.00, -0.2, 0.00, 0},
+    {48000, 0.00, -0.2, 0.00, 0},
+    {50000, -0.01, 0.4, 0.00, 0},
+    {52000, -0.01, 0.4, 0.00, 0},
+    {54000, -0.01, 0.4, 0.00, 0},
+    {56000, -0.00, -0.6, 0.00, 0},
+    {58000, -0.00, -0.6, 0.00, 0},
+    {60000, 0.01, -0.1, 0.00, 0},
+    {62000, 0.01, -0.1, 0.00, 0},
+    {64000, 0.01, -0.1, 0.00, 0},
+    {66000, -0.02, -0.3, 0.00, 0},
+    {68000, -0.02, -0.3, 0.00, 0},
+    {70000, -0.01, -0.0, 0.00, 0},
+    {72000, -0.01, -0.0, 0.00, 0},
+    {74000, -0.01, -0.0, 0.00, 0},
+    {76000, -0.01, 0.0, 0.00, 0},
+    {78000, -0.01, 0.0, 0.00, 0},
+    {80000, 0.04, -0.2, 0.00, 0},
+    {82000, 0.04, -0.2, 0.00, 0},
+    {84000, 0.04, -0.2, 0.00, 0},
+    {86000, -0.02, -0.1, 0.00, 0},
+    {88000, -0.02, -0.1, 0.00, 0},
+    {90000, 0.02, -0.2, 0.00, 0},
+    {92000, 0.02, -0.2, 0.00, 0},
+    {94000, 0.02, -0.2, 0.00, 0},
+    {96000, 0.03, -0.4, 0.00, 0},
+    {98000, 0.03, -0.4, 0.00, 0},
+    {100000, -0.02, -0.0, 0.00, 0},
+};
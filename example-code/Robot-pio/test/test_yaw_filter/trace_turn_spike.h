@@ -0,0 +1,387 @@
+// Glitch trace: a 90 degree right turn read every 2 ms, the sensor updating at 200 Hz.
+// Two sensor updates are off, +25 degrees at 200 ms and -12 degrees at 350 ms, and repeat
+// until the next update. Columns: read time us, yaw and rate read, true yaw, 1 when the
+// read must be flagged as an outlier.
+static const TraceSample traceTurnSpike[] = {
+    {0, 0.03, 0.4, 0.00, 0},
+    {2000, 0.03, 0.4, 0.00, 0},
+    {4000, 0.03, 0.4, 0.00, 0},
+    {6000, 0.00, -0.2, 0.00, 0},
+    {8000, 0.00, -0.2, 0.00, 0},
+    {10000, -0.02, 0.0, 0.00, 0},
+    {12000, -0.02, 0.0, 0.00, 0},
+    {14000, -0.02, 0.0, 0.00, 0},
+    {16000, -0.02, -0.4, 0.00, 0},
+    {18000, -0.02, -0.4, 0.00, 0},
+    {20000, 0.00, 0.0, 0.00, 0},
+    {22000, 0.00, 0.0, -0.00, 0},
+    {24000, 0.00, 0.0, -0.01, 0},
+    {26000, 0.00, -4.3, -0.01, 0},
+    {28000, 0.00, -4.3, -0.03, 0},
+    {30000, -0.04, -8.0, -0.04, 0},
+    {32000, -0.04, -8.0, -0.06, 0},
+    {34000, -0.04, -8.0, -0.08, 0},
+    {36000, -0.12, -11.8, -0.10, 0},
+    {38000, -0.12, -11.8, -0.13, 0},
+    {40000, -0.15, -15.3, -0.16, 0},
+    {42000, -0.15, -15.3, -0.19, 0},
+    {44000, -0.15, -15.3, -0.23, 0},
+    {46000, -0.25, -20.0, -0.27, 0},
+    {48000, -0.25, -20.0, -0.31, 0},
+    {50000, -0.34, -23.9, -0.36, 0},
+    {52000, -0.34, -23.9, -0.41, 0},
+    {54000, -0.34, -23.9, -0.46, 0},
+    {56000, -0.47, -28.1, -0.52, 0},
+    {58000, -0.47, -28.1, -0.58, 0},
+    {60000, -0.64, -31.7, -0.64, 0},
+    {62000, -0.64, -31.7, -0.71, 0},
+    {64000, -0.64, -31.7, -0.77, 0},
+    {66000, -0.80, -36.0, -0.85, 0},
+    {68000, -0.80, -36.0, -0.92, 0},
+    {70000, -1.02, -39.9, -1.00, 0},
+    {72000, -1.02, -39.9, -1.08, 0},
+    {74000, -1.02, -39.9, -1.17, 0},
+    {76000, -1.21, -43.8, -1.25, 0},
+    {78000, -1.21, -43.8, -1.35, 0},
+    {80000, -1.44, -47.7, -1.44, 0},
+    {82000, -1.44, -47.7, -1.54, 0},
+    {84000, -1.44, -47.7, -1.64, 0},
+    {86000, -1.69, -51.9, -1.74, 0},
+    {88000, -1.69, -51.9, -1.85, 0},
+    {90000, -1.95, -56.3, -1.96, 0},
+    {92000, -1.95, -56.3, -2.07, 0},
+    {94000, -1.95, -56.3, -2.19, 0},
+    {96000, -2.26, -60.2, -2.31, 0},
+    {98000, -2.26, -60.2, -2.43, 0},
+    {100000, -2.52, -64.0, -2.56, 0},
+    {102000, -2.52, -64.0, -2.69, 0},
+    {104000, -2.52, -64.0, -2.82, 0},
+    {106000, -2.88, -67.8, -2.96, 0},
+    {108000, -2.88, -67.8, -3.10, 0},
+    {110000, -3.25, -72.5, -3.24, 0},
+    {112000, -3.25, -72.5, -3.39, 0},
+    {114000, -3.25, -72.5, -3.53, 0},
+    {116000, -3.59, -76.1, -3.69, 0},
+    {118000, -3.59, -76.1, -3.84, 0},
+    {120000, -3.99, -80.4, -4.00, 0},
+    {122000, -3.99, -80.4, -4.16, 0},
+    {124000, -3.99, -80.4, -4.33, 0},
+    {126000, -4.42, -83.6, -4.49, 0},
+    {128000, -4.42, -83.6, -4.67, 0},
+    {130000, -4.81, -88.4, -4.84, 0},
+    {132000, -4.81, -88.4, -5.02, 0},
+    {134000, -4.81, -88.4, -5.20, 0},
+    {136000, -5.32, -92.0, -5.38, 0},
+    {138000, -5.32, -92.0, -5.57, 0},
+    {140000, -5.75, -96.0, -5.76, 0},
+    {142000, -5.75, -96.0, -5.95, 0},
+    {144000, -5.75, -96.0, -6.15, 0},
+    {146000, -6.24, -100.3, -6.35, 0},
+    {148000, -6.24, -100.3, -6.55, 0},
+    {150000, -6.75, -103.7, -6.76, 0},
+    {152000, -6.75, -103.7, -6.97, 0},
+    {154000, -6.75, -103.7, -7.18, 0},
+    {156000, -7.30, -108.4, -7.40, 0},
+    {158000, -7.30, -108.4, -7.62, 0},
+    {160000, -7.86, -111.8, -7.84, 0},
+    {162000, -7.86, -111.8, -8.07, 0},
+    {164000, -7.86, -111.8, -8.29, 0},
+    {166000, -8.44, -116.0, -8.53, 0},
+    {168000, -8.44, -116.0, -8.76, 0},
+    {170000, -9.02, -120.0, -9.00, 0},
+    {172000, -9.02, -120.0, -9.24, 0},
+    {174000, -9.02, -120.0, -9.49, 0},
+    {176000, -9.61, -124.0, -9.73, 0},
+    {178000, -9.61, -124.0, -9.99, 0},
+    {180000, -10.21, -127.9, -10.24, 0},
+    {182000, -10.21, -127.9, -10.50, 0},
+    {184000, -10.21, -127.9, -10.76, 0},
+    {186000, -10.86, -132.0, -11.02, 0},
+    {188000, -10.86, -132.0, -11.29, 0},
+    {190000, -11.57, -135.9, -11.56, 0},
+    {192000, -11.57, -135.9, -11.83, 0},
+    {194000, -11.57, -135.9, -12.11, 0},
+    {196000, -12.31, -140.0, -12.39, 0},
+    {198000, -12.31, -140.0, -12.67, 0},
+    {200000, 12.04, -144.4, -12.96, 1},
+    {202000, 12.04, -144.4, -13.25, 1},
+    {204000, 12.04, -144.4, -13.54, 1},
+    {206000, -13.68, -148.2, -13.84, 0},
+    {208000, -13.68, -148.2, -14.14, 0},
+    {210000, -14.49, -152.1, -14.44, 0},
+    {212000, -14.49, -152.1, -14.75, 0},
+    {214000, -14.49, -152.1, -15.05, 0},
+    {216000, -15.23, -156.2, -15.37, 0},
+    {218000, -15.23, -156.2, -15.68, 0},
+    {220000, -16.00, -159.6, -16.00, 0},
+    {222000, -16.00, -159.6, -16.32, 0},
+    {224000, -16.00, -159.6, -16.65, 0},
+    {226000, -16.81, -164.0, -16.97, 0},
+    {228000, -16.81, -164.0, -17.31, 0},
+    {230000, -17.63, -168.5, -17.64, 0},
+    {232000, -17.63, -168.5, -17.98, 0},
+    {234000, -17.63, -168.5, -18.32, 0},
+    {236000, -18.47, -172.3, -18.66, 0},
+    {238000, -18.47, -172.3, -19.01, 0},
+    {240000, -19.35, -176.3, -19.36, 0},
+    {242000, -19.35, -176.3, -19.71, 0},
+    {244000, -19.35, -176.3, -20.07, 0},
+    {246000, -20.27, -180.1, -20.43, 0},
+    {248000, -20.27, -180.1, -20.79, 0},
+    {250000, -21.12, -183.8, -21.16, 0},
+    {252000, -21.12, -183.8, -21.53, 0},
+    {254000, -21.12, -183.8, -21.90, 0},
+    {256000, -22.10, -188.1, -22.28, 0},
+    {258000, -22.10, -188.1, -22.66, 0},
+    {260000, -23.06, -192.0, -23.04, 0},
+    {262000, -23.06, -192.0, -23.43, 0},
+    {264000, -23.06, -192.0, -23.81, 0},
+    {266000, -24.02, -195.8, -24.21, 0},
+    {268000, -24.02, -195.8, -24.60, 0},
+    {270000, -25.03, -200.1, -25.00, 0},
+    {272000, -25.03, -200.1, -25.40, 0},
+    {274000, -25.03, -200.1, -25.80, 0},
+    {276000, -26.02, -200.2, -26.20, 0},
+    {278000, -26.02, -200.2, -26.60, 0},
+    {280000, -26.99, -200.0, -27.00, 0},
+    {282000, -26.99, -200.0, -27.40, 0},
+    {284000, -26.99, -200.0, -27.80, 0},
+    {286000, -27.99, -199.6, -28.20, 0},
+    {288000, -27.99, -199.6, -28.60, 0},
+    {290000, -28.98, -200.4, -29.00, 0},
+    {292000, -28.98, -200.4, -29.40, 0},
+    {294000, -28.98, -200.4, -29.80, 0},
+    {296000, -29.99, -200.5, -30.20, 0},
+    {298000, -29.99, -200.5, -30.60, 0},
+    {300000, -31.00, -199.4, -31.00, 0},
+    {302000, -31.00, -199.4, -31.40, 0},
+    {304000, -31.00, -199.4, -31.80, 0},
+    {306000, -32.00, -200.1, -32.20, 0},
+    {308000, -32.00, -200.1, -32.60, 0},
+    {310000, -33.00, -200.0, -33.00, 0},
+    {312000, -33.00, -200.0, -33.40, 0},
+    {314000, -33.00, -200.0, -33.80, 0},
+    {316000, -34.00, -200.2, -34.20, 0},
+    {318000, -34.00, -200.2, -34.60, 0},
+    {320000, -34.98, -199.7, -35.00, 0},
+    {322000, -34.98, -199.7, -35.40, 0},
+    {324000, -34.98, -199.7, -35.80, 0},
+    {326000, -36.00, -199.9, -36.20, 0},
+    {328000, -36.00, -199.9, -36.60, 0},
+    {330000, -36.99, -199.7, -37.00, 0},
+    {332000, -36.99, -199.7, -37.40, 0},
+    {334000, -36.99, -199.7, -37.80, 0},
+    {336000, -37.99, -199.8, -38.20, 0},
+    {338000, -37.99, -199.8, -38.60, 0},
+    {340000, -39.01, -200.3, -39.00, 0},
+    {342000, -39.01, -200.3, -39.40, 0},
+    {344000, -39.01, -200.3, -39.80, 0},
+    {346000, -40.01, -199.7, -40.20, 0},
+    {348000, -40.01, -199.7, -40.60, 0},
+    {350000, -52.98, -200.0, -41.00, 1},
+    {352000, -52.98, -200.0, -41.40, 1},
+    {354000, -52.98, -200.0, -41.80, 1},
+    {356000, -42.01, -199.9, -42.20, 0},
+    {358000, -42.01, -199.9, -42.60, 0},
+    {360000, -42.97, -199.6, -43.00, 0},
+    {362000, -42.97, -199.6, -43.40, 0},
+    {364000, -42.97, -199.6, -43.80, 0},
+    {366000, -44.01, -200.0, -44.20, 0},
+    {368000, -44.01, -200.0, -44.60, 0},
+    {370000, -45.03, -200.3, -45.00, 0},
+    {372000, -45.03, -200.3, -45.40, 0},
+    {374000, -45.03, -200.3, -45.80, 0},
+    {376000, -46.00, -200.0, -46.20, 0},
+    {378000, -46.00, -200.0, -46.60, 0},
+    {380000, -46.98, -199.6, -47.00, 0},
+    {382000, -46.98, -199.6, -47.40, 0},
+    {384000, -46.98, -199.6, -47.80, 0},
+    {386000, -47.98, -199.6, -48.20, 0},
+    {388000, -47.98, -199.6, -48.60, 0},
+    {390000, -49.01, -200.3, -49.00, 0},
+    {392000, -49.01, -200.3, -49.40, 0},
+    {394000, -49.01, -200.3, -49.80, 0},
+    {396000, -49.99, -199.2, -50.20, 0},
+    {398000, -49.99, -199.2, -50.60, 0},
+    {400000, -50.99, -200.3, -51.00, 0},
+    {402000, -50.99, -200.3, -51.40, 0},
+    {404000, -50.99, -200.3, -51.80, 0},
+    {406000, -52.00, -199.6, -52.20, 0},
+    {408000, -52.00, -199.6, -52.60, 0},
+    {410000, -53.02, -199.8, -53.00, 0},
+    {412000, -53.02, -199.8, -53.40, 0},
+    {414000, -53.02, -199.8, -53.80, 0},
+    {416000, -54.01, -199.6, -54.20, 0},
+    {418000, -54.01, -199.6, -54.60, 0},
+    {420000, -54.98, -199.9, -55.00, 0},
+    {422000, -54.98, -199.9, -55.40, 0},
+    {424000, -54.98, -199.9, -55.80, 0},
+    {426000, -55.96, -200.1, -56.20, 0},
+    {428000, -55.96, -200.1, -56.60, 0},
+    {430000, -57.01, -199.4, -57.00, 0},
+    {432000, -57.01, -199.4, -57.40, 0},
+    {434000, -57.01, -199.4, -57.80, 0},
+    {436000, -58.02, -199.3, -58.20, 0},
+    {438000, -58.02, -199.3, -58.60, 0},
+    {440000, -59.00, -200.3, -59.00, 0},
+    {442000, -59.00, -200.3, -59.40, 0},
+    {444000, -59.00, -200.3, -59.80, 0},
+    {446000, -60.00, -200.0, -60.20, 0},
+    {448000, -60.00, -200.0, -60.60, 0},
+    {450000, -61.00, -200.1, -61.00, 0},
+    {452000, -61.00, -200.1, -61.40, 0},
+    {454000, -61.00, -200.1, -61.80, 0},
+    {456000, -61.98, -200.7, -62.20, 0},
+    {458000, -61.98, -200.7, -62.60, 0},
+    {460000, -63.01, -200.1, -63.00, 0},
+    {462000, -63.01, -200.1, -63.40, 0},
+    {464000, -63.01, -200.1, -63.80, 0},
+    {466000, -63.96, -200.6, -64.20, 0},
+    {468000, -63.96, -200.6, -64.60, 0},
+    {470000, -65.01, -200.3, -65.00, 0},
+    {472000, -65.01, -200.3, -65.40, 0},
+    {474000, -65.01, -200.3, -65.79, 0},
+    {476000, -66.00, -195.8, -66.19, 0},
+    {478000, -66.00, -195.8, -66.57, 0},
+    {480000, -66.95, -191.6, -66.96, 0},
+    {482000, -66.95, -191.6, -67.34, 0},
+    {484000, -66.95, -191.6, -67.72, 0},
+    {486000, -67.92, -187.9, -68.10, 0},
+    {488000, -67.92, -187.9, -68.47, 0},
+    {490000, -68.82, -183.7, -68.84, 0},
+    {492000, -68.82, -183.7, -69.21, 0},
+    {494000, -68.82, -183.7, -69.57, 0},
+    {496000, -69.76, -179.7, -69.93, 0},
+    {498000, -69.76, -179.7, -70.29, 0},
+    {500000, -70.66, -175.5, -70.64, 0},
+    {502000, -70.66, -175.5, -70.99, 0},
+    {504000, -70.66, -175.5, -71.34, 0},
+    {506000, -71.51, -172.0, -71.68, 0},
+    {508000, -71.51, -172.0, -72.02, 0},
+    {510000, -72.35, -167.7, -72.36, 0},
+    {512000, -72.35, -167.7, -72.69, 0},
+    {514000, -72.35, -167.7, -73.03, 0},
+    {516000, -73.16, -164.0, -73.35, 0},
+    {518000, -73.16, -164.0, -73.68, 0},
+    {520000, -74.01, -159.8, -74.00, 0},
+    {522000, -74.01, -159.8, -74.32, 0},
+    {524000, -74.01, -159.8, -74.63, 0},
+    {526000, -74.81, -156.5, -74.95, 0},
+    {528000, -74.81, -156.5, -75.25, 0},
+    {530000, -75.54, -152.1, -75.56, 0},
+    {532000, -75.54, -152.1, -75.86, 0},
+    {534000, -75.54, -152.1, -76.16, 0},
+    {536000, -76.29, -148.3, -76.46, 0},
+    {538000, -76.29, -148.3, -76.75, 0},
+    {540000, -77.10, -143.9, -77.04, 0},
+    {542000, -77.10, -143.9, -77.33, 0},
+    {544000, -77.10, -143.9, -77.61, 0},
+    {546000, -77.75, -139.5, -77.89, 0},
+    {548000, -77.75, -139.5, -78.17, 0},
+    {550000, -78.43, -135.9, -78.44, 0},
+    {552000, -78.43, -135.9, -78.71, 0},
+    {554000, -78.43, -135.9, -78.98, 0},
+    {556000, -79.10, -132.1, -79.24, 0},
+    {558000, -79.10, -132.1, -79.50, 0},
+    {560000, -79.76, -128.4, -79.76, 0},
+    {562000, -79.76, -128.4, -80.01, 0},
+    {564000, -79.76, -128.4, -80.27, 0},
+    {566000, -80.38, -124.2, -80.51, 0},
+    {568000, -80.38, -124.2, -80.76, 0},
+    {570000, -81.01, -119.8, -81.00, 0},
+    {572000, -81.01, -119.8, -81.24, 0},
+    {574000, -81.01, -119.8, -81.47, 0},
+    {576000, -81.57, -116.3, -81.71, 0},
+    {578000, -81.57, -116.3, -81.93, 0},
+    {580000, -82.12, -112.2, -82.16, 0},
+    {582000, -82.12, -112.2, -82.38, 0},
+    {584000, -82.12, -112.2, -82.60, 0},
+    {586000, -82.69, -107.7, -82.82, 0},
+    {588000, -82.69, -107.7, -83.03, 0},
+    {590000, -83.24, -103.9, -83.24, 0},
+    {592000, -83.24, -103.9, -83.45, 0},
+    {594000, -83.24, -103.9, -83.65, 0},
+    {596000, -83.71, -99.7, -83.85, 0},
+    {598000, -83.71, -99.7, -84.05, 0},
+    {600000, -84.23, -96.5, -84.24, 0},
+    {602000, -84.23, -96.5, -84.43, 0},
+    {604000, -84.23, -96.5, -84.62, 0},
+    {606000, -84.72, -91.7, -84.80, 0},
+    {608000, -84.72, -91.7, -84.98, 0},
+    {610000, -85.16, -88.3, -85.16, 0},
+    {612000, -85.16, -88.3, -85.33, 0},
+    {614000, -85.16, -88.3, -85.51, 0},
+    {616000, -85.60, -84.1, -85.67, 0},
+    {618000, -85.60, -84.1, -85.84, 0},
+    {620000, -85.99, -79.9, -86.00, 0},
+    {622000, -85.99, -79.9, -86.16, 0},
+    {624000, -85.99, -79.9, -86.31, 0},
+    {626000, -86.37, -76.2, -86.47, 0},
+    {628000, -86.37, -76.2, -86.61, 0},
+    {630000, -86.74, -72.2, -86.76, 0},
+    {632000, -86.74, -72.2, -86.90, 0},
+    {634000, -86.74, -72.2, -87.04, 0},
+    {636000, -87.12, -67.5, -87.18, 0},
+    {638000, -87.12, -67.5, -87.31, 0},
+    {640000, -87.44, -64.0, -87.44, 0},
+    {642000, -87.44, -64.0, -87.57, 0},
+    {644000, -87.44, -64.0, -87.69, 0},
+    {646000, -87.75, -60.1, -87.81, 0},
+    {648000, -87.75, -60.1, -87.93, 0},
+    {650000, -88.01, -55.6, -88.04, 0},
+    {652000, -88.01, -55.6, -88.15, 0},
+    {654000, -88.01, -55.6, -88.26, 0},
+    {656000, -88.30, -51.9, -88.36, 0},
+    {658000, -88.30, -51.9, -88.46, 0},
+    {660000, -88.54, -48.0, -88.56, 0},
+    {662000, -88.54, -48.0, -88.65, 0},
+    {664000, -88.54, -48.0, -88.75, 0},
+    {666000, -88.78, -43.9, -88.83, 0},
+    {668000, -88.78, -43.9, -88.92, 0},
+    {670000, -89.00, -39.5, -89.00, 0},
+    {672000, -89.00, -39.5, -89.08, 0},
+    {674000, -89.00, -39.5, -89.15, 0},
+    {676000, -89.15, -35.6, -89.23, 0},
+    {678000, -89.15, -35.6, -89.29, 0},
+    {680000, -89.40, -31.4, -89.36, 0},
+    {682000, -89.40, -31.4, -89.42, 0},
+    {684000, -89.40, -31.4, -89.48, 0},
+    {686000, -89.50, -28.1, -89.54, 0},
+    {688000, -89.50, -28.1, -89.59, 0},
+    {690000, -89.64, -23.7, -89.64, 0},
+    {692000, -89.64, -23.7, -89.69, 0},
+    {694000, -89.64, -23.7, -89.73, 0},
+    {696000, -89.73, -19.7, -89.77, 0},
+    {698000, -89.73, -19.7, -89.81, 0},
+    {700000, -89.84, -16.0, -89.84, 0},
+    {702000, -89.84, -16.0, -89.87, 0},
+    {704000, -89.84, -16.0, -89.90, 0},
+    {706000, -89.89, -12.0, -89.92, 0},
+    {708000, -89.89, -12.0, -89.94, 0},
+    {710000, -89.98, -8.2, -89.96, 0},
+    {712000, -89.98, -8.2, -89.97, 0},
+    {714000, -89.98, -8.2, -89.99, 0},
+    {716000, -89.99, -3.9, -89.99, 0},
+    {718000, -89.99, -3.9, -90.00, 0},
+    {720000, -89.95, -0.4, -90.00, 0},
+    {722000, -89.95, -0.4, -90.00, 0},
+    {724000, -89.95, -0.4, -90.00, 0},
+    {726000, -89.99, -0.0, -90.00, 0},
+    {728000, -89.99, -0.0, -90.00, 0},
+    {730000, -89.99, 0.4, -90.00, 0},
+    {732000, -89.99, 0.4, -90.00, 0},
+    {734000, -89.99, 0.4, -90.00, 0},
+    {736000, -89.98, -0.0, -90.00, 0},
+    {738000, -89.98, -0.0, -90.00, 0},
+    {740000, -90.01, -0.4, -90.00, 0},
+    {742000, -90.01, -0.4, -90.00, 0},
+    {744000, -90.01, -0.4, -90.00, 0},
+    {746000, -90.00, 0.4, -90.00, 0},
+    {748000, -90.00, 0.4, -90.00, 0},
+    {750000, -90.01, 0.2, -90.00, 0},
+    {752000, -90.01, 0.2, -90.00, 0},
+    {754000, -90.01, 0.2, -90.00, 0},
+    {756000, -89.99, 0.1, -90.00, 0},
+    {758000, -89.99, 0.1, -90.00, 0},
+    {760000, -89.98, -0.0, -90.00, 0},
+};
@@ -0,0 +1,310 @@
+// Clean trace: a 60 degree left turn from 150 degrees, through the wrap at +-180 degrees.
+// No read may be flagged. Columns as in trace_turn_spike.h.
+static const TraceSample traceWrap[] = {
+    {0, 150.05, -0.2, 150.00, 0},
+    {2000, 150.05, -0.2, 150.00, 0},
+    {4000, 150.05, -0.2, 150.00, 0},
+    {6000, 150.01, 0.0, 150.00, 0},
+    {8000, 150.01, 0.0, 150.00, 0},
+    {10000, 150.02, -0.4, 150.00, 0},
+    {12000, 150.02, -0.4, 150.00, 0},
+    {14000, 150.02, -0.4, 150.00, 0},
+    {16000, 149.99, -0.2, 150.00, 0},
+    {18000, 149.99, -0.2, 150.00, 0},
+    {20000, 149.98, -0.3, 150.00, 0},
+    {22000, 149.98, -0.3, 150.00, 0},
+    {24000, 149.98, -0.3, 150.01, 0},
+    {26000, 150.00, 3.9, 150.01, 0},
+    {28000, 150.00, 3.9, 150.03, 0},
+    {30000, 150.02, 8.1, 150.04, 0},
+    {32000, 150.02, 8.1, 150.06, 0},
+    {34000, 150.02, 8.1, 150.08, 0},
+    {36000, 150.08, 11.0, 150.10, 0},
+    {38000, 150.08, 11.0, 150.13, 0},
+    {40000, 150.18, 15.9, 150.16, 0},
+    {42000, 150.18, 15.9, 150.19, 0},
+    {44000, 150.18, 15.9, 150.23, 0},
+    {46000, 150.24, 20.1, 150.27, 0},
+    {48000, 150.24, 20.1, 150.31, 0},
+    {50000, 150.36, 24.0, 150.36, 0},
+    {52000, 150.36, 24.0, 150.41, 0},
+    {54000, 150.36, 24.0, 150.46, 0},
+    {56000, 150.47, 28.1, 150.52, 0},
+    {58000, 150.47, 28.1, 150.58, 0},
+    {60000, 150.61, 32.4, 150.64, 0},
+    {62000, 150.61, 32.4, 150.71, 0},
+    {64000, 150.61, 32.4, 150.77, 0},
+    {66000, 150.78, 35.9, 150.85, 0},
+    {68000, 150.78, 35.9, 150.92, 0},
+    {70000, 151.00, 40.1, 151.00, 0},
+    {72000, 151.00, 40.1, 151.08, 0},
+    {74000, 151.00, 40.1, 151.17, 0},
+    {76000, 151.21, 44.1, 151.25, 0},
+    {78000, 151.21, 44.1, 151.35, 0},
+    {80000, 151.37, 47.9, 151.44, 0},
+    {82000, 151.37, 47.9, 151.54, 0},
+    {84000, 151.37, 47.9, 151.64, 0},
+    {86000, 151.68, 51.8, 151.74, 0},
+    {88000, 151.68, 51.8, 151.85, 0},
+    {90000, 151.99, 55.7, 151.96, 0},
+    {92000, 151.99, 55.7, 152.07, 0},
+    {94000, 151.99, 55.7, 152.19, 0},
+    {96000, 152.25, 59.3, 152.31, 0},
+    {98000, 152.25, 59.3, 152.43, 0},
+    {100000, 152.56, 63.5, 152.56, 0},
+    {102000, 152.56, 63.5, 152.69, 0},
+    {104000, 152.56, 63.5, 152.82, 0},
+    {106000, 152.86, 68.7, 152.96, 0},
+    {108000, 152.86, 68.7, 153.10, 0},
+    {110000, 153.25, 72.0, 153.24, 0},
+    {112000, 153.25, 72.0, 153.39, 0},
+    {114000, 153.25, 72.0, 153.53, 0},
+    {116000, 153.61, 75.5, 153.69, 0},
+    {118000, 153.61, 75.5, 153.84, 0},
+    {120000, 153.98, 80.1, 154.00, 0},
+    {122000, 153.98, 80.1, 154.16, 0},
+    {124000, 153.98, 80.1, 154.33, 0},
+    {126000, 154.36, 84.0, 154.49, 0},
+    {128000, 154.36, 84.0, 154.67, 0},
+    {130000, 154.80, 88.0, 154.84, 0},
+    {132000, 154.80, 88.0, 155.02, 0},
+    {134000, 154.80, 88.0, 155.20, 0},
+    {136000, 155.26, 92.5, 155.38, 0},
+    {138000, 155.26, 92.5, 155.57, 0},
+    {140000, 155.78, 95.8, 155.76, 0},
+    {142000, 155.78, 95.8, 155.95, 0},
+    {144000, 155.78, 95.8, 156.15, 0},
+    {146000, 156.21, 99.7, 156.35, 0},
+    {148000, 156.21, 99.7, 156.55, 0},
+    {150000, 156.76, 103.7, 156.76, 0},
+    {152000, 156.76, 103.7, 156.97, 0},
+    {154000, 156.76, 103.7, 157.18, 0},
+    {156000, 157.29, 108.3, 157.40, 0},
+    {158000, 157.29, 108.3, 157.62, 0},
+    {160000, 157.84, 111.8, 157.84, 0},
+    {162000, 157.84, 111.8, 158.07, 0},
+    {164000, 157.84, 111.8, 158.29, 0},
+    {166000, 158.42, 115.9, 158.53, 0},
+    {168000, 158.42, 115.9, 158.76, 0},
+    {170000, 159.01, 119.9, 159.00, 0},
+    {172000, 159.01, 119.9, 159.24, 0},
+    {174000, 159.01, 119.9, 159.49, 0},
+    {176000, 159.64, 123.9, 159.73, 0},
+    {178000, 159.64, 123.9, 159.99, 0},
+    {180000, 160.22, 128.0, 160.24, 0},
+    {182000, 160.22, 128.0, 160.50, 0},
+    {184000, 160.22, 128.0, 160.76, 0},
+    {186000, 160.87, 131.7, 161.02, 0},
+    {188000, 160.87, 131.7, 161.29, 0},
+    {190000, 161.55, 136.2, 161.56, 0},
+    {192000, 161.55, 136.2, 161.83, 0},
+    {194000, 161.55, 136.2, 162.11, 0},
+    {196000, 162.20, 139.9, 162.39, 0},
+    {198000, 162.20, 139.9, 162.67, 0},
+    {200000, 162.95, 143.9, 162.96, 0},
+    {202000, 162.95, 143.9, 163.25, 0},
+    {204000, 162.95, 143.9, 163.54, 0},
+    {206000, 163.70, 147.6, 163.84, 0},
+    {208000, 163.70, 147.6, 164.14, 0},
+    {210000, 164.45, 151.9, 164.44, 0},
+    {212000, 164.45, 151.9, 164.75, 0},
+    {214000, 164.45, 151.9, 165.05, 0},
+    {216000, 165.21, 155.9, 165.37, 0},
+    {218000, 165.21, 155.9, 165.68, 0},
+    {220000, 165.99, 159.8, 166.00, 0},
+    {222000, 165.99, 159.8, 166.32, 0},
+    {224000, 165.99, 159.8, 166.65, 0},
+    {226000, 166.82, 164.6, 166.97, 0},
+    {228000, 166.82, 164.6, 167.31, 0},
+    {230000, 167.66, 168.2, 167.64, 0},
+    {232000, 167.66, 168.2, 167.98, 0},
+    {234000, 167.66, 168.2, 168.32, 0},
+    {236000, 168.50, 171.8, 168.66, 0},
+    {238000, 168.50, 171.8, 169.01, 0},
+    {240000, 169.37, 176.6, 169.36, 0},
+    {242000, 169.37, 176.6, 169.71, 0},
+    {244000, 169.37, 176.6, 170.07, 0},
+    {246000, 170.22, 180.2, 170.43, 0},
+    {248000, 170.22, 180.2, 170.79, 0},
+    {250000, 171.18, 184.1, 171.16, 0},
+    {252000, 171.18, 184.1, 171.53, 0},
+    {254000, 171.18, 184.1, 171.90, 0},
+    {256000, 172.10, 188.4, 172.28, 0},
+    {258000, 172.10, 188.4, 172.66, 0},
+    {260000, 173.08, 192.4, 173.04, 0},
+    {262000, 173.08, 192.4, 173.43, 0},
+    {264000, 173.08, 192.4, 173.81, 0},
+    {266000, 174.04, 196.1, 174.21, 0},
+    {268000, 174.04, 196.1, 174.60, 0},
+    {270000, 175.02, 200.0, 175.00, 0},
+    {272000, 175.02, 200.0, 175.40, 0},
+    {274000, 175.02, 200.0, 175.80, 0},
+    {276000, 176.00, 199.8, 176.20, 0},
+    {278000, 176.00, 199.8, 176.60, 0},
+    {280000, 177.01, 200.4, 177.00, 0},
+    {282000, 177.01, 200.4, 177.40, 0},
+    {284000, 177.01, 200.4, 177.80, 0},
+    {286000, 178.00, 200.1, 178.20, 0},
+    {288000, 178.00, 200.1, 178.60, 0},
+    {290000, 179.01, 200.0, 179.00, 0},
+    {292000, 179.01, 200.0, 179.40, 0},
+    {294000, 179.01, 200.0, 179.80, 0},
+    {296000, -179.98, 200.1, -179.80, 0},
+    {298000, -179.98, 200.1, -179.40, 0},
+    {300000, -179.02, 199.7, -179.00, 0},
+    {302000, -179.02, 199.7, -178.60, 0},
+    {304000, -179.02, 199.7, -178.20, 0},
+    {306000, -177.99, 200.2, -177.80, 0},
+    {308000, -177.99, 200.2, -177.40, 0},
+    {310000, -176.98, 200.1, -177.00, 0},
+    {312000, -176.98, 200.1, -176.60, 0},
+    {314000, -176.98, 200.1, -176.20, 0},
+    {316000, -176.00, 199.5, -175.80, 0},
+    {318000, -176.00, 199.5, -175.40, 0},
+    {320000, -174.97, 199.7, -175.00, 0},
+    {322000, -174.97, 199.7, -174.60, 0},
+    {324000, -174.97, 199.7, -174.21, 0},
+    {326000, -173.99, 195.6, -173.81, 0},
+    {328000, -173.99, 195.6, -173.43, 0},
+    {330000, -173.05, 192.0, -173.04, 0},
+    {332000, -173.05, 192.0, -172.66, 0},
+    {334000, -173.05, 192.0, -172.28, 0},
+    {336000, -172.10, 187.8, -171.90, 0},
+    {338000, -172.10, 187.8, -171.53, 0},
+    {340000, -171.14, 184.2, -171.16, 0},
+    {342000, -171.14, 184.2, -170.79, 0},
+    {344000, -171.14, 184.2, -170.43, 0},
+    {346000, -170.24, 179.9, -170.07, 0},
+    {348000, -170.24, 179.9, -169.71, 0},
+    {350000, -169.38, 175.8, -169.36, 0},
+    {352000, -169.38, 175.8, -169.01, 0},
+    {354000, -169.38, 175.8, -168.66, 0},
+    {356000, -168.50, 172.0, -168.32, 0},
+    {358000, -168.50, 172.0, -167.98, 0},
+    {360000, -167.63, 167.9, -167.64, 0},
+    {362000, -167.63, 167.9, -167.31, 0},
+    {364000, -167.63, 167.9, -166.97, 0},
+    {366000, -166.83, 163.8, -166.65, 0},
+    {368000, -166.83, 163.8, -166.32, 0},
+    {370000, -165.97, 160.0, -166.00, 0},
+    {372000, -165.97, 160.0, -165.68, 0},
+    {374000, -165.97, 160.0, -165.37, 0},
+    {376000, -165.21, 156.1, -165.05, 0},
+    {378000, -165.21, 156.1, -164.75, 0},
+    {380000, -164.43, 152.0, -164.44, 0},
+    {382000, -164.43, 152.0, -164.14, 0},
+    {384000, -164.43, 152.0, -163.84, 0},
+    {386000, -163.67, 148.2, -163.54, 0},
+    {388000, -163.67, 148.2, -163.25, 0},
+    {390000, -163.02, 144.0, -162.96, 0},
+    {392000, -163.02, 144.0, -162.67, 0},
+    {394000, -163.02, 144.0, -162.39, 0},
+    {396000, -162.19, 139.6, -162.11, 0},
+    {398000, -162.19, 139.6, -161.83, 0},
+    {400000, -161.56, 136.3, -161.56, 0},
+    {402000, -161.56, 136.3, -161.29, 0},
+    {404000, -161.56, 136.3, -161.02, 0},
+    {406000, -160.89, 132.4, -160.76, 0},
+    {408000, -160.89, 132.4, -160.50, 0},
+    {410000, -160.27, 127.6, -160.24, 0},
+    {412000, -160.27, 127.6, -159.99, 0},
+    {414000, -160.27, 127.6, -159.73, 0},
+    {416000, -159.61, 123.8, -159.49, 0},
+    {418000, -159.61, 123.8, -159.24, 0},
+    {420000, -159.02, 120.2, -159.00, 0},
+    {422000, -159.02, 120.2, -158.76, 0},
+    {424000, -159.02, 120.2, -158.53, 0},
+    {426000, -158.40, 116.0, -158.29, 0},
+    {428000, -158.40, 116.0, -158.07, 0},
+    {430000, -157.85, 112.1, -157.84, 0},
+    {432000, -157.85, 112.1, -157.62, 0},
+    {434000, -157.85, 112.1, -157.40, 0},
+    {436000, -157.29, 107.8, -157.18, 0},
+    {438000, -157.29, 107.8, -156.97, 0},
+    {440000, -156.75, 104.1, -156.76, 0},
+    {442000, -156.75, 104.1, -156.55, 0},
+    {444000, -156.75, 104.1, -156.35, 0},
+    {446000, -156.25, 100.2, -156.15, 0},
+    {448000, -156.25, 100.2, -155.95, 0},
+    {450000, -155.78, 96.0, -155.76, 0},
+    {452000, -155.78, 96.0, -155.57, 0},
+    {454000, -155.78, 96.0, -155.38, 0},
+    {456000, -155.30, 92.4, -155.20, 0},
+    {458000, -155.30, 92.4, -155.02, 0},
+    {460000, -154.83, 88.6, -154.84, 0},
+    {462000, -154.83, 88.6, -154.67, 0},
+    {464000, -154.83, 88.6, -154.49, 0},
+    {466000, -154.38, 83.9, -154.33, 0},
+    {468000, -154.38, 83.9, -154.16, 0},
+    {470000, -154.02, 80.1, -154.00, 0},
+    {472000, -154.02, 80.1, -153.84, 0},
+    {474000, -154.02, 80.1, -153.69, 0},
+    {476000, -153.62, 76.0, -153.53, 0},
+    {478000, -153.62, 76.0, -153.39, 0},
+    {480000, -153.26, 72.2, -153.24, 0},
+    {482000, -153.26, 72.2, -153.10, 0},
+    {484000, -153.26, 72.2, -152.96, 0},
+    {486000, -152.89, 68.1, -152.82, 0},
+    {488000, -152.89, 68.1, -152.69, 0},
+    {490000, -152.55, 63.7, -152.56, 0},
+    {492000, -152.55, 63.7, -152.43, 0},
+    {494000, -152.55, 63.7, -152.31, 0},
+    {496000, -152.29, 59.9, -152.19, 0},
+    {498000, -152.29, 59.9, -152.07, 0},
+    {500000, -151.97, 55.8, -151.96, 0},
+    {502000, -151.97, 55.8, -151.85, 0},
+    {504000, -151.97, 55.8, -151.74, 0},
+    {506000, -151.67, 52.0, -151.64, 0},
+    {508000, -151.67, 52.0, -151.54, 0},
+    {510000, -151.41, 48.1, -151.44, 0},
+    {512000, -151.41, 48.1, -151.35, 0},
+    {514000, -151.41, 48.1, -151.25, 0},
+    {516000, -151.20, 44.2, -151.17, 0},
+    {518000, -151.20, 44.2, -151.08, 0},
+    {520000, -150.98, 39.6, -151.00, 0},
+    {522000, -150.98, 39.6, -150.92, 0},
+    {524000, -150.98, 39.6, -150.85, 0},
+    {526000, -150.79, 36.0, -150.77, 0},
+    {528000, -150.79, 36.0, -150.71, 0},
+    {530000, -150.66, 32.2, -150.64, 0},
+    {532000, -150.66, 32.2, -150.58, 0},
+    {534000, -150.66, 32.2, -150.52, 0},
+    {536000, -150.48, 28.4, -150.46, 0},
+    {538000, -150.48, 28.4, -150.41, 0},
+    {540000, -150.35, 24.1, -150.36, 0},
+    {542000, -150.35, 24.1, -150.31, 0},
+    {544000, -150.35, 24.1, -150.27, 0},
+    {546000, -150.28, 20.5, -150.23, 0},
+    {548000, -150.28, 20.5, -150.19, 0},
+    {550000, -150.13, 16.2, -150.16, 0},
+    {552000, -150.13, 16.2, -150.13, 0},
+    {554000, -150.13, 16.2, -150.10, 0},
+    {556000, -150.08, 12.4, -150.08, 0},
+    {558000, -150.08, 12.4, -150.06, 0},
+    {560000, -150.06, 8.2, -150.04, 0},
+    {562000, -150.06, 8.2, -150.03, 0},
+    {564000, -150.06, 8.2, -150.01, 0},
+    {566000, -150.01, 3.7, -150.01, 0},
+    {568000, -150.01, 3.7, -150.00, 0},
+    {570000, -149.99, 0.1, -150.00, 0},
+    {572000, -149.99, 0.1, -150.00, 0},
+    {574000, -149.99, 0.1, -150.00, 0},
+    {576000, -149.97, 0.3, -150.00, 0},
+    {578000, -149.97, 0.3, -150.00, 0},
+    {580000, -150.03, -0.6, -150.00, 0},
+    {582000, -150.03, -0.6, -150.00, 0},
+    {584000, -150.03, -0.6, -150.00, 0},
+    {586000, -150.00, -0.1, -150.00, 0},
+    {588000, -150.00, -0.1, -150.00, 0},
+    {590000, -150.02, -0.4, -150.00, 0},
+    {592000, -150.02, -0.4, -150.00, 0},
+    {594000, -150.02, -0.4, -150.00, 0},
+    {596000, -150.00, -0.3, -150.00, 0},
+    {598000, -150.00, -0.3, -150.00, 0},
+    {600000, -150.01, 0.3, -150.00, 0},
+    {602000, -150.01, 0.3, -150.00, 0},
+    {604000, -150.01, 0.3, -150.00, 0},
+    {606000, -150.00, -0.2, -150.00, 0},
+    {608000, -150.00, -0.2, -150.00, 0},
+    {610000, -150.02, -0.1, -150.00, 0},
+};
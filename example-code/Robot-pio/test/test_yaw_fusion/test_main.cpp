@@ -0,0 +1,154 @@
+// Host simulation of the gyro fusion: a turn read from a sensor whose angle register
+// lags its gyro register, as the JY901's does. The fused yaw must follow the robot with
+// no more than the gyro register's own delay, where the angle register alone lags by the
+// sensor's filter, and must not drift with a gyro bias.
+#include <unity.h>
+#include <stdio.h>
+#include <math.h>
+#include "YawFusion.h"
+
+// IMU.h fusion settings
+#define FUSION_TIME_CONSTANT 0.05
+#define FUSION_ANGLE_LAG 0.015
+
+// The sensor: registers updated at 200 Hz, read every 2 ms
+#define SENSOR_PERIOD_US 5000
+#define READ_PERIOD_US 2000
+#define GYRO_DELAY 0.003 // s, the gyro register behind the robot
+#define ANGLE_LAG 0.015  // s, the angle register behind the gyro register
+
+// Turn profile
+#define TURN_RATE 200.0   // degrees/s
+#define TURN_ACCEL 800.0  // degrees/s^2
+
+struct Motion
+{
+    double yaw;  // degrees, unwrapped
+    double rate; // degrees/s
+};
+
+struct Result
+{
+    double fusedLag;  // s, mean of the yaw error over the rate while turning at full rate
+    double angleLag;  // s, the same for the angle register alone
+    double fusedError; // degrees, largest error of the fused yaw over the whole run
+    double finalError; // degrees, error at the end
+};
+
+// A turn of angle degrees from start degrees, starting at 0.1 s
+static Motion turnAt(double start, double angle, double t)
+{
+    double s = angle < 0 ? -1 : 1;
+    double a = fabs(angle);
+    double ta = TURN_RATE / TURN_ACCEL;
+    double ramp = 0.5 * TURN_ACCEL * ta * ta;
+    double tc = (a - 2 * ramp) / TURN_RATE;
+    double total = 2 * ta + tc;
+    t -= 0.1;
+    if (t <= 0)
+        return {start, 0};
+    if (t < ta)
+        return {start + s * 0.5 * TURN_ACCEL * t * t, s * TURN_ACCEL * t};
+    if (t < ta + tc)
+        return {start + s * (ramp + TURN_RATE * (t - ta)), s * TURN_RATE};
+    if (t < total)
+    {
+        double u = total - t;
+        return {start + s * (a - 0.5 * TURN_ACCEL * u * u), s * TURN_ACCEL * u};
+    }
+    return {start + s * a, 0};
+}
+
+static double wrap(double degrees)
+{
+    while (degrees > 180)
+        degrees -= 360;
+    while (degrees <= -180)
+        degrees += 360;
+    return degrees;
+}
+
+// Simulate a turn for duration s, the gyro reading bias degrees/s too much
+static Result simulate(double start, double angle, double duration, double bias)
+{
+    YawFusion fusion(FUSION_TIME_CONSTANT, FUSION_ANGLE_LAG);
+    Result result = {0, 0, 0, 0};
+    double fusedLagSum = 0, angleLagSum = 0;
+    int cruiseReads = 0;
+
+    for (uint32_t micros = 0; micros <= duration * 1e6; micros += READ_PERIOD_US)
+    {
+        // The registers as of their last update
+        double update = (micros / SENSOR_PERIOD_US) * SENSOR_PERIOD_US / 1e6;
+        double rate = turnAt(start, angle, update - GYRO_DELAY).rate + bias;
+        double angleRegister = wrap(turnAt(start, angle, update - GYRO_DELAY - ANGLE_LAG).yaw);
+
+        double fused = fusion.update(angleRegister, rate, micros);
+        Motion robot = turnAt(start, angle, micros / 1e6);
+        double error = wrap(robot.yaw - fused);
+        if (fabs(error) > result.fusedError)
+            result.fusedError = fabs(error);
+        result.finalError = error;
+
+        // Once at full rate for longer than the lags
+        Motion earlier = turnAt(start, angle, micros / 1e6 - 0.05);
+        if (fabs(robot.rate) == TURN_RATE && fabs(earlier.rate) == TURN_RATE)
+        {
+            fusedLagSum += error / robot.rate;
+            angleLagSum += wrap(robot.yaw - angleRegister) / robot.rate;
+            cruiseReads++;
+        }
+    }
+    if (cruiseReads > 0)
+    {
+        result.fusedLag = fusedLagSum / cruiseReads;
+        result.angleLag = angleLagSum / cruiseReads;
+    }
+    return result;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_fusion_cuts_the_angle_lag()
+{
+    Result result = simulate(0, 90, 1.0, 0);
+    printf("90 degree turn: angle register lags %.1f ms, fused yaw %.1f ms, largest error %.2f degrees\n",
+           result.angleLag * 1000, result.fusedLag * 1000, result.fusedError);
+
+    // The angle register is behind by the gyro delay, the sensor's filter and half an update
+    TEST_ASSERT_FLOAT_WITHIN(0.002, GYRO_DELAY + ANGLE_LAG + SENSOR_PERIOD_US / 2e6, result.angleLag);
+    // The fused yaw only by the gyro delay and the hold of the registers
+    TEST_ASSERT_TRUE(result.fusedLag < GYRO_DELAY + SENSOR_PERIOD_US / 1e6);
+    TEST_ASSERT_TRUE(result.fusedLag < result.angleLag / 2);
+    TEST_ASSERT_TRUE(result.fusedError < TURN_RATE * (GYRO_DELAY + SENSOR_PERIOD_US / 1e6));
+    TEST_ASSERT_FLOAT_WITHIN(0.05, 0, result.finalError);
+}
+
+void test_fusion_through_the_wrap()
+{
+    Result result = simulate(150, 90, 1.0, 0);
+    TEST_ASSERT_TRUE(result.fusedLag < GYRO_DELAY + SENSOR_PERIOD_US / 1e6);
+    TEST_ASSERT_TRUE(result.fusedError < TURN_RATE * (GYRO_DELAY + SENSOR_PERIOD_US / 1e6));
+    TEST_ASSERT_FLOAT_WITHIN(0.05, 0, result.finalError);
+}
+
+// A gyro bias is pulled back by the angle register, integrated alone it would add up
+void test_gyro_bias_does_not_drift()
+{
+    double bias = 0.5; // degrees/s
+    Result result = simulate(0, 90, 10.0, bias);
+    printf("0.5 degrees/s gyro bias over 10 s: fused yaw off by %.3f degrees, integrated alone by 5 degrees\n",
+           fabs(result.finalError));
+    TEST_ASSERT_FLOAT_WITHIN(2 * bias * FUSION_TIME_CONSTANT, 0, result.finalError);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_fusion_cuts_the_angle_lag);
+    RUN_TEST(test_fusion_through_the_wrap);
+    RUN_TEST(test_gyro_bias_does_not_drift);
+    return UNITY_END();
+}